@@ -0,0 +1,139 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#include "AllocationTracker.h"
+#include "NeuralNetwork.h"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+namespace {
+    const int phase_count = 3;
+    std::atomic<unsigned long> allocation_counts[phase_count];
+    std::atomic<unsigned long> deallocation_counts[phase_count];
+    std::atomic<unsigned long> allocated_bytes[phase_count];
+    thread_local int current_phase = -1; // -1: not inside any Scope, nothing is counted
+
+    [[maybe_unused]] void recordAllocation(std::size_t size) {
+        if (current_phase < 0) return;
+        allocation_counts[current_phase].fetch_add(1, std::memory_order_relaxed);
+        allocated_bytes[current_phase].fetch_add(size, std::memory_order_relaxed);
+    }
+
+    [[maybe_unused]] void recordDeallocation() {
+        if (current_phase < 0) return;
+        deallocation_counts[current_phase].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const char* phaseName(TrainingPhase phase) {
+        switch (phase) {
+            case ForwardPass: return "forward";
+            case BackwardPass: return "backward";
+            case WeightUpdate: return "update";
+            default: return "?";
+        }
+    }
+}
+
+#ifdef NN_TRACK_ALLOCATIONS
+// replacements of the global allocation functions. the array, nothrow and sized forms forward to these in the standard library
+void* operator new(std::size_t size) {
+    recordAllocation(size);
+    if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    recordAllocation(size);
+    std::size_t align = static_cast<std::size_t>(alignment);
+    if (void* ptr = std::aligned_alloc(align, (size + align - 1) / align * align)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    if (!ptr) return;
+    recordDeallocation();
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+    operator delete(ptr);
+}
+#endif
+
+bool AllocationTracker::isEnabled() {
+#ifdef NN_TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AllocationTracker::reset() {
+    for (int i=0; i<phase_count; ++i) {
+        allocation_counts[i] = 0;
+        deallocation_counts[i] = 0;
+        allocated_bytes[i] = 0;
+    }
+}
+
+AllocationStats AllocationTracker::getStats(TrainingPhase phase) {
+    return {allocation_counts[phase].load(), deallocation_counts[phase].load(), allocated_bytes[phase].load()};
+}
+
+AllocationTracker::Scope::Scope(TrainingPhase phase)
+    : previous_phase(current_phase) {
+    current_phase = phase;
+}
+
+AllocationTracker::Scope::~Scope() {
+    current_phase = previous_phase;
+}
+
+bool AllocationTracker::verifyAllocationFreeSteps(NeuralNetwork& net, const std::vector<std::vector<double>> &X_train, const std::vector<std::vector<double>> &Y_train,
+                                                  LossFxn loss_fxn, int warmup_steps, int checked_steps) {
+    if (!isEnabled()) {
+        std::cerr << "Allocation tracking is off, rebuild with NN_TRACK_ALLOCATIONS" << std::endl;
+        return false;
+    }
+    if (X_train.empty() || X_train[0].size() != net.getInputSize()) {
+        std::cerr << "Samples don't match with the network's input size" << std::endl;
+        return false;
+    }
+    int batch_size = static_cast<int>(X_train.size());
+    for (int step=0; step<warmup_steps+checked_steps; ++step) {
+        if (step == warmup_steps) reset();
+        bool counted = step >= warmup_steps;
+        auto runPhase = [counted](TrainingPhase phase, auto&& fxn) {
+            if (!counted) return fxn();
+            Scope scope(phase);
+            fxn();
+        };
+
+        runPhase(BackwardPass, [&] { net.clearAllWeightBiasGradients(); });
+        for (int i=0; i<batch_size; ++i) {
+            runPhase(ForwardPass, [&] { net.forwardProp(X_train[i]); });
+            runPhase(BackwardPass, [&] { net.backProp(X_train[i], Y_train[i], loss_fxn, batch_size); });
+        }
+        runPhase(WeightUpdate, [&] { net.gradientDescent(); });
+    }
+
+    bool allocation_free = true;
+    for (auto phase : {ForwardPass, BackwardPass, WeightUpdate}) {
+        AllocationStats stats = getStats(phase);
+        std::cout << phaseName(phase) << ": " << stats.allocations << " allocations, " << stats.deallocations
+                  << " deallocations, " << stats.bytes << " bytes over " << checked_steps << " steps" << std::endl;
+        allocation_free = allocation_free && stats.allocations == 0 && stats.deallocations == 0;
+    }
+    return allocation_free;
+}
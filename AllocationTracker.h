@@ -0,0 +1,43 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef ALLOCATIONTRACKER_H
+#define ALLOCATIONTRACKER_H
+
+#include <vector>
+#include "utility.h"
+
+class NeuralNetwork;
+
+struct AllocationStats {
+    unsigned long allocations;
+    unsigned long deallocations;
+    unsigned long bytes;
+};
+
+// Counts global operator new/delete per TrainingPhase on the calling thread.
+// Only active when built with NN_TRACK_ALLOCATIONS (cmake -DNN_TRACK_ALLOCATIONS=ON), otherwise every count stays 0.
+class AllocationTracker {
+public:
+    static bool isEnabled();
+    static void reset();
+    static AllocationStats getStats(TrainingPhase);
+
+    // RAII: allocations made while alive are charged to the phase
+    class Scope {
+        int previous_phase;
+    public:
+        explicit Scope(TrainingPhase);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+    // Runs warmup_steps training steps (forward, backward, gradient descent over the samples), then checked_steps more
+    // while counting. Prints the counts per phase and returns true when the checked steps didn't allocate at all.
+    static bool verifyAllocationFreeSteps(NeuralNetwork&, const std::vector<std::vector<double>> &X_train, const std::vector<std::vector<double>> &Y_train,
+                                          LossFxn, int warmup_steps = 2, int checked_steps = 5);
+};
+
+#endif //ALLOCATIONTRACKER_H
@@ -0,0 +1,250 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#include "BatchedTrainer.h"
+#include "NeuralNetwork.h"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+BatchedTrainer::BatchedTrainer(NeuralNetwork& _net, unsigned int input_size, size_t _batch_size, LossFxn _loss_fxn,
+                               size_t _checkpoint_every)
+    : net(_net), batch_size(std::max<size_t>(_batch_size, 1)), loss_fxn(_loss_fxn),
+      checkpoint_every(std::max<size_t>(_checkpoint_every, 1)), communicator(_net.getCommunicator()),
+      exchange_jobs(_net.getLayerReadOnly().size() + 2), exchange_results(_net.getLayerReadOnly().size() + 2) {
+    if (net.getInputSize() != input_size) {
+        net.adjustFirstLayer(static_cast<int>(input_size), net.getLayerReadOnly()[0].getActivationType());
+    }
+    if (communicator) {
+        if (!net.broadcastWeights()) exchange_failed = true;
+        exchange_thread = std::thread(&BatchedTrainer::exchangeLoop, this);
+    }
+    const auto& layers = net.getLayerReadOnly();
+    size_t L = layers.size();
+
+    // step schedule: 0 loads the batch, 1..L forward, L+1 loss, then the segments from the output backwards,
+    // each recomputing its non-checkpointed layers in order and then running backward from its last layer
+    const int load = 0, forward_start = 1, loss = static_cast<int>(L) + 1;
+    std::vector<int> recompute(L, -1), backward(L);
+    int step = loss;
+    for (size_t last = L; last-- > 0;) {
+        size_t first = last;
+        while (first > 0 && !isCheckpoint(first-1, L)) --first;
+        for (size_t l=first; l<last; ++l) recompute[l] = ++step;
+        for (size_t l=last+1; l-- > first;) backward[l] = ++step;
+        last = first;
+    }
+    const size_t d = sizeof(double);
+
+    MemoryPlanner planner;
+    x_id = planner.addBuffer("X", batch_size * input_size * d, load, backward[0]);
+    y_id = planner.addBuffer("Y", batch_size * layers[L-1].getNeuronCount() * d, load, loss);
+    for (size_t l=0; l<L; ++l) {
+        size_t m = layers[l].getNeuronCount(), n = l == 0 ? input_size : layers[l-1].getNeuronCount();
+        std::string suffix = std::to_string(l);
+        int forward_step = forward_start + static_cast<int>(l);
+        int last_read = l == L-1 ? loss : backward[l+1]; // the next layer's backward reads a (gradient and derivative)
+        if (isCheckpoint(l, L)) {
+            a_ids.push_back(planner.addBuffer("a" + suffix, batch_size * m * d, forward_step, last_read));
+            recompute_a_ids.push_back(a_ids.back());
+        }
+        else { // only alive until the next layer's forward, then again from its recomputation on
+            a_ids.push_back(planner.addBuffer("a" + suffix, batch_size * m * d, forward_step, forward_step + 1));
+            recompute_a_ids.push_back(planner.addBuffer("a" + suffix + "'", batch_size * m * d, recompute[l], last_read));
+        }
+        delta_ids.push_back(planner.addBuffer("delta" + suffix, batch_size * m * d, last_read, backward[l]));
+        int applied = communicator && l > 0 ? backward[l-1] : backward[l]; // exchanged during the next layer's backward
+        gradient_ids.push_back(planner.addBuffer("dW,db" + suffix, (m * n + m) * d, backward[l], applied));
+    }
+    plan = planner.plan();
+    arena = Arena(plan);
+}
+
+BatchedTrainer::~BatchedTrainer() {
+    if (exchange_thread.joinable()) {
+        exchange_jobs.push({nullptr, 0, 0, false, true});
+        exchange_thread.join();
+    }
+}
+
+void BatchedTrainer::exchangeLoop() {
+    // the only thread using the communicator while a step runs, the main thread waits for the results before it
+    // calls it itself. after a failure the remaining jobs fail without waiting on the peers again
+    bool ok = !exchange_failed;
+    double share = 0;
+    while (true) {
+        ExchangeJob job = exchange_jobs.pop();
+        if (job.stop) return;
+        if (job.exact) {
+            ok = ok && communicator->allReduce(job.values, 1);
+            share = ok ? step_rows / *job.values : 0;
+            continue;
+        }
+        if (ok) { // the gradients are means over our rows, weight them by our share of all ranks' rows
+            for (size_t k=0; k<job.count; ++k) job.values[k] *= share;
+            ok = communicator->allReduceGradients(job.values, job.count, job.stream);
+        }
+        exchange_results.push(ok);
+    }
+}
+
+bool BatchedTrainer::isCheckpoint(size_t l, size_t layer_count) const {
+    return (l + 1) % checkpoint_every == 0 || l == layer_count - 1;
+}
+
+const MemoryPlan& BatchedTrainer::getMemoryPlan() const {
+    return plan;
+}
+
+double BatchedTrainer::runStep(size_t rows) {
+    auto& layers = net.getLayers();
+    size_t L = layers.size();
+    unsigned int input_size = net.getInputSize();
+    auto buffer = [this](size_t id) { return arena.doubles(plan, id); };
+
+    if (communicator) { // the row count goes around while the forward pass runs
+        step_rows = total_rows = static_cast<double>(rows);
+        exchange_jobs.push({&total_rows, 1, 0, true, false});
+    }
+
+    const double* input = buffer(x_id);
+    size_t input_n = input_size;
+    for (size_t l=0; l<L; ++l) {
+        layers[l].forwardBatch(input, input_n, rows, buffer(a_ids[l]));
+        input = buffer(a_ids[l]);
+        input_n = layers[l].getNeuronCount();
+    }
+
+    size_t out_n = layers[L-1].getNeuronCount();
+    const double* output = buffer(a_ids[L-1]);
+    const double* Y = buffer(y_id);
+    double loss = 0;
+    for (size_t b=0; b<rows; ++b) {
+        loss += loss_compute(loss_fxn, output + b*out_n, Y + b*out_n, out_n);
+    }
+    layers[L-1].lastLayerDeltaBatch(output, Y, rows, loss_fxn, buffer(delta_ids[L-1]));
+
+    double eta = net.getLearningRate();
+    size_t exchanging = L; // layer whose gradients are being all-reduced, L = none
+    auto applyExchanged = [&] {
+        if (exchanging == L) return;
+        if (!exchange_results.pop()) exchange_failed = true;
+        size_t weight_count = layers[exchanging].getNeuronCount() * (exchanging == 0 ? input_size : layers[exchanging-1].getNeuronCount());
+        double* gradient = buffer(gradient_ids[exchanging]);
+        if (!exchange_failed) layers[exchanging].applyGradients(gradient, gradient + weight_count, eta);
+        exchanging = L;
+    };
+    for (size_t last = L; last-- > 0;) {
+        size_t first = last;
+        while (first > 0 && !isCheckpoint(first-1, L)) --first;
+        for (size_t l=first; l<last; ++l) { // recompute the segment from the checkpoint before it
+            const double* prev_a = l == 0 ? buffer(x_id) : buffer(recompute_a_ids[l-1]);
+            size_t prev_n = l == 0 ? input_size : layers[l-1].getNeuronCount();
+            layers[l].forwardBatch(prev_a, prev_n, rows, buffer(recompute_a_ids[l]));
+        }
+        for (size_t l=last+1; l-- > first;) {
+            const double* prev_a = l == 0 ? buffer(x_id) : buffer(recompute_a_ids[l-1]);
+            size_t prev_n = l == 0 ? input_size : layers[l-1].getNeuronCount();
+            size_t m = layers[l].getNeuronCount();
+            double* weight_gradient = buffer(gradient_ids[l]);
+            double* bias_gradient = weight_gradient + m * prev_n;
+            layers[l].weightGradientBatch(buffer(delta_ids[l]), prev_a, prev_n, rows, weight_gradient, bias_gradient);
+            if (communicator) exchange_jobs.push({weight_gradient, m * prev_n + m, l, false, false});
+            if (l > 0) { // needs this layer's weights before they're updated
+                layers[l].propagateDeltaBatch(buffer(delta_ids[l]), rows, buffer(delta_ids[l-1]));
+                layers[l-1].activationDerivativeBatch(buffer(recompute_a_ids[l-1]), rows, buffer(delta_ids[l-1]));
+            }
+            if (communicator) { // the layer above has had this layer's backward to finish its all-reduce
+                applyExchanged();
+                exchanging = l;
+            }
+            else {
+                layers[l].applyGradients(weight_gradient, bias_gradient, eta);
+            }
+        }
+        last = first;
+    }
+    applyExchanged();
+    return loss;
+}
+
+double BatchedTrainer::step(const double* X, const double* Y, size_t rows) {
+    rows = std::min(rows, batch_size);
+    if (rows == 0) return 0;
+    if (net.isInferenceOnly()) {
+        std::cerr << "Error: the network was compacted for inference and can't be trained" << std::endl;
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    size_t input_n = net.getInputSize(), out_n = net.getLayerReadOnly().back().getNeuronCount();
+    std::copy(X, X + rows*input_n, arena.doubles(plan, x_id));
+    std::copy(Y, Y + rows*out_n, arena.doubles(plan, y_id));
+    double loss = runStep(rows) / static_cast<double>(rows);
+    return exchange_failed ? std::numeric_limits<double>::quiet_NaN() : loss;
+}
+
+void BatchedTrainer::fit(const std::vector<std::vector<double>> &X_train, const std::vector<std::vector<double>> &Y_train, int epoch) {
+    size_t sample_size = X_train.size();
+    size_t input_n = net.getInputSize(), out_n = net.getLayerReadOnly().back().getNeuronCount();
+    bool shaped = sample_size > 0 && Y_train.size() == sample_size;
+    for (size_t i=0; shaped && i<sample_size; ++i) { // every row is copied with its own size into the step's buffers
+        shaped = X_train[i].size() == input_n && Y_train[i].size() == out_n;
+    }
+    if (!shaped) {
+        std::cerr << "Error: training data doesn't match the trainer's input and output sizes" << std::endl;
+        return;
+    }
+    if (net.isInferenceOnly()) {
+        std::cerr << "Error: the network was compacted for inference and can't be trained" << std::endl;
+        return;
+    }
+    sample_indices.resize(sample_size);
+    std::iota(sample_indices.begin(), sample_indices.end(), 0);
+    double* X = arena.doubles(plan, x_id);
+    double* Y = arena.doubles(plan, y_id);
+
+    size_t steps = (sample_size + batch_size - 1) / batch_size;
+    if (communicator) { // every rank has to take the same number of steps
+        std::vector<double> rank_steps(communicator->size(), 0.0);
+        rank_steps[communicator->rank()] = static_cast<double>(steps);
+        if (!communicator->allReduce(rank_steps.data(), rank_steps.size())) {
+            std::cerr << "Error: cannot agree on the steps per epoch with the other ranks" << std::endl;
+            return;
+        }
+        steps = static_cast<size_t>(*std::min_element(rank_steps.begin(), rank_steps.end()));
+    }
+
+    std::mt19937& rng = net.getRng(); // setSeed makes the shuffle reproducible, like fit's
+    for (int _=0; _<epoch; ++_) {
+        for (size_t i=sample_size-1; i>0; --i) { // Fisher-Yates
+            std::swap(sample_indices[i], sample_indices[std::uniform_int_distribution<size_t>(0, i)(rng)]);
+        }
+        double cost = 0;
+        size_t seen = 0;
+        for (size_t start=0; start<steps*batch_size && start<sample_size; start+=batch_size) {
+            size_t rows = std::min(batch_size, sample_size - start);
+            for (size_t b=0; b<rows; ++b) { // gather the batch straight into the arena
+                size_t k = sample_indices[start + b];
+                std::copy(X_train[k].begin(), X_train[k].end(), X + b*input_n);
+                std::copy(Y_train[k].begin(), Y_train[k].end(), Y + b*out_n);
+            }
+            cost += runStep(rows);
+            seen += rows;
+            if (exchange_failed) {
+                std::cerr << "Error: gradient all-reduce failed, stopping fit" << std::endl;
+                return;
+            }
+        }
+        if (communicator) {
+            double totals[2] = {cost, static_cast<double>(seen)};
+            if (!communicator->allReduce(totals, 2)) {
+                std::cerr << "Error: gradient all-reduce failed, stopping fit" << std::endl;
+                return;
+            }
+            cost = totals[0];
+            seen = static_cast<size_t>(totals[1]);
+            if (communicator->rank() != 0) continue;
+        }
+        if (net.isVerbose()) std::cout << "Cost is: " << cost / static_cast<double>(seen) << std::endl;
+    }
+}
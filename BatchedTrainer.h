@@ -0,0 +1,81 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef BATCHEDTRAINER_H
+#define BATCHEDTRAINER_H
+
+#include <thread>
+#include <vector>
+#include "BoundedQueue.h"
+#include "MemoryPlanner.h"
+#include "utility.h"
+
+class Communicator;
+class NeuralNetwork;
+
+// Mini-batch training on whole batches at once (Layer's *Batch kernels) instead of sample by sample through the
+// neurons. Every activation, delta and gradient buffer of a step is planned up front by
+// MemoryPlanner and lives in one Arena, so steps don't allocate and the peak memory is known before training.
+// Each layer's weights are updated as soon as its delta has been propagated, so one layer's gradient buffer is
+// alive at a time. The plan is for the network's shape at construction, make a new trainer after changing it.
+//
+// With checkpoint_every = k, the forward pass only keeps the outputs of every k-th layer (and the last). Backward
+// goes segment by segment from the output, first recomputing the segment's other layers from the checkpoint
+// before it, so activation memory is about L/k + k layers instead of L, for one extra forward pass. The
+// recomputation uses the same kernels and not yet updated weights, so the result is the same as without it.
+//
+// When the network has a communicator (NeuralNetwork::setCommunicator), training is data-parallel like fit: the
+// trainer starts from rank 0's weights, and a thread all-reduces each layer's gradients while the layers below it
+// run backward. A layer is then updated once the next one down has its gradients, so its gradient buffer lives
+// one layer longer.
+class BatchedTrainer {
+    struct ExchangeJob {
+        double* values;
+        size_t count;
+        size_t stream;
+        bool exact; // the step's row count, summed before its gradients
+        bool stop;
+    };
+
+    NeuralNetwork& net;
+    size_t batch_size;
+    LossFxn loss_fxn;
+    size_t checkpoint_every;
+    MemoryPlan plan;
+    Arena arena;
+    size_t x_id, y_id;
+    // per layer. checkpointed layers use the forward buffers in backward too, the others get them recomputed
+    std::vector<size_t> a_ids, recompute_a_ids;
+    std::vector<size_t> delta_ids, gradient_ids; // a layer's weight gradients, then its bias gradients
+    std::vector<size_t> sample_indices;
+    Communicator* communicator;
+    double step_rows = 0, total_rows = 0;
+    bool exchange_failed = false;
+    BoundedQueue<ExchangeJob> exchange_jobs;
+    BoundedQueue<bool> exchange_results; // one per gradient job, in order
+    std::thread exchange_thread;
+
+    bool isCheckpoint(size_t l, size_t layer_count) const;
+    double runStep(size_t rows); // on the rows already in the X/Y buffers, returns the summed loss
+    void exchangeLoop();
+
+public:
+    // resizes the first layer like fit when the network isn't shaped for input_size yet.
+    // checkpoint_every 0 (or 1) keeps every layer's activations
+    BatchedTrainer(NeuralNetwork&, unsigned int input_size, size_t batch_size, LossFxn = MSE, size_t checkpoint_every = 0);
+    ~BatchedTrainer();
+    BatchedTrainer(const BatchedTrainer&) = delete;
+    BatchedTrainer& operator=(const BatchedTrainer&) = delete;
+
+    const MemoryPlan& getMemoryPlan() const;
+    // one step on rows <= batch size samples (row-major X and Y), returns their mean loss before the update.
+    // NaN once the gradient all-reduce has failed, the weights are no longer updated then
+    double step(const double* X, const double* Y, size_t rows);
+    // one shuffled pass of batch size steps per epoch (with the network's rng), prints the running cost like the
+    // streaming fit when the network is verbose. data-parallel, every rank takes as many steps as the rank with the
+    // fewest samples, and rank 0 prints the mean over all ranks
+    void fit(const std::vector<std::vector<double>> &X_train, const std::vector<std::vector<double>> &Y_train, int epoch);
+};
+
+#endif //BATCHEDTRAINER_H
@@ -0,0 +1,261 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#include "Benchmark.h"
+#include "NeuralNetwork.h"
+#include "AllocationTracker.h"
+#include "BatchedTrainer.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <sstream>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double secondsSince(const Clock::time_point& start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    NeuralNetwork buildNetwork(const BenchmarkCase& bench_case) {
+        NeuralNetwork model;
+        for (const auto& [size, activation] : bench_case.layers) {
+            model.addLayer(size, activation);
+        }
+        model.adjustFirstLayer(static_cast<int>(bench_case.input_size), bench_case.layers[0].second);
+        model.setLearningRate(1e-6); // keep the weights (and so the timings) stable across iterations
+        return model;
+    }
+
+    void buildDataset(const BenchmarkCase& bench_case, std::vector<std::vector<double>>& X, std::vector<std::vector<double>>& Y) {
+        std::mt19937 gen(42); // fixed seed so every run sees the same data
+        std::uniform_real_distribution<> dist(-1.0, 1.0);
+        unsigned int output_size = bench_case.layers.back().first;
+
+        X.assign(bench_case.sample_size, std::vector<double>(bench_case.input_size));
+        Y.assign(bench_case.sample_size, std::vector<double>(output_size, 0.0));
+        for (unsigned int i=0; i<bench_case.sample_size; ++i) {
+            for (auto& x : X[i]) x = dist(gen);
+            switch (bench_case.loss_fxn) {
+                case BinaryCrossEntropy:
+                    for (auto& y : Y[i]) y = dist(gen) > 0 ? 1.0 : 0.0;
+                    break;
+                case CategoricalCrossEntropy:
+                    Y[i][gen() % output_size] = 1.0;
+                    break;
+                default:
+                    for (auto& y : Y[i]) y = dist(gen);
+                    break;
+            }
+        }
+    }
+
+    // runs fxn (which processes `samples_per_call` samples) until min_seconds passed, best of repetitions
+    template <typename Fxn>
+    double measureThroughput(Fxn&& fxn, double samples_per_call, double min_seconds, int repetitions) {
+        double best = 0;
+        for (int r=0; r<repetitions; ++r) {
+            double samples = 0;
+            auto start = Clock::now();
+            do {
+                fxn();
+                samples += samples_per_call;
+            } while (secondsSince(start) < min_seconds);
+            best = std::max(best, samples / secondsSince(start));
+        }
+        return best;
+    }
+}
+
+void Benchmark::addCase(const BenchmarkCase& bench_case) {
+    cases.push_back(bench_case);
+}
+
+void Benchmark::addDefaultCases() {
+    // the model trained in main.cpp
+    addCase({"main_linear", 2, {{12, LINEAR}, {10, LINEAR}, {5, LINEAR}, {1, LINEAR}}, MSE, 64, 20});
+    addCase({"relu_mlp", 32, {{128, RELU}, {128, RELU}, {10, SOFTMAX}}, CategoricalCrossEntropy, 64, 5});
+    addCase({"deep_sigmoid", 16, {{32, SIGMOID}, {32, TANH}, {32, SIGMOID}, {32, TANH}, {1, SIGMOID}}, BinaryCrossEntropy, 64, 10});
+}
+
+void Benchmark::setMinSeconds(double seconds) {
+    min_seconds = seconds;
+}
+
+void Benchmark::setRepetitions(int n) {
+    repetitions = std::max(1, n);
+}
+
+std::map<std::string, double> Benchmark::run() const {
+    std::map<std::string, double> results;
+    std::ostringstream silenced; // fit prints the cost every epoch
+    for (const auto& bench_case : cases) {
+        std::vector<std::vector<double>> X, Y;
+        buildDataset(bench_case, X, Y);
+        NeuralNetwork model = buildNetwork(bench_case);
+        double n = static_cast<double>(X.size());
+
+        results[bench_case.name + ".forward"] = measureThroughput([&] {
+            for (const auto& x : X) model.forwardProp(x);
+        }, n, min_seconds, repetitions);
+
+        // backward is timed on its own: every sample is forwarded once (untimed), then backProp repeated on that state
+        const int backward_reps = 8;
+        double best_backward = 0;
+        for (int r=0; r<repetitions; ++r) {
+            double elapsed = 0, samples = 0;
+            do {
+                model.clearAllWeightBiasGradients();
+                for (size_t i=0; i<X.size(); ++i) {
+                    model.forwardProp(X[i]);
+                    auto start = Clock::now();
+                    for (int k=0; k<backward_reps; ++k) {
+                        model.backProp(X[i], Y[i], bench_case.loss_fxn, static_cast<int>(X.size()));
+                    }
+                    elapsed += secondsSince(start);
+                }
+                samples += n * backward_reps;
+            } while (elapsed < min_seconds);
+            best_backward = std::max(best_backward, samples / elapsed);
+        }
+        results[bench_case.name + ".backward"] = best_backward;
+
+        auto* cout_buf = std::cout.rdbuf(silenced.rdbuf());
+        results[bench_case.name + ".fit"] = measureThroughput([&] {
+            model.fit(X, Y, bench_case.fit_epochs, bench_case.loss_fxn);
+            silenced.str("");
+        }, n * bench_case.fit_epochs, min_seconds, repetitions);
+        std::cout.rdbuf(cout_buf);
+    }
+    return results;
+}
+
+void Benchmark::printRooflineReports() const {
+    MachinePeak peak = measureMachinePeak();
+    for (const auto& bench_case : cases) {
+        std::vector<std::vector<double>> X, Y;
+        buildDataset(bench_case, X, Y);
+        NeuralNetwork model = buildNetwork(bench_case);
+        model.profileLayers(X, Y, bench_case.loss_fxn); // warm up
+        std::cout << std::endl << bench_case.name << ":" << std::endl;
+        printRooflineReport(model.profileLayers(X, Y, bench_case.loss_fxn), peak);
+    }
+}
+
+bool Benchmark::verifyAllocationFreeSteps() const {
+    bool allocation_free = true;
+    for (const auto& bench_case : cases) {
+        std::vector<std::vector<double>> X, Y;
+        buildDataset(bench_case, X, Y);
+        NeuralNetwork model = buildNetwork(bench_case);
+        std::cout << bench_case.name << ":" << std::endl;
+        allocation_free = AllocationTracker::verifyAllocationFreeSteps(model, X, Y, bench_case.loss_fxn) && allocation_free;
+    }
+    return allocation_free;
+}
+
+void Benchmark::printMemoryPlans(size_t batch_size, size_t checkpoint_every) const {
+    for (const auto& bench_case : cases) {
+        NeuralNetwork model = buildNetwork(bench_case);
+        BatchedTrainer trainer(model, bench_case.input_size, batch_size, bench_case.loss_fxn, checkpoint_every);
+        std::cout << std::endl << bench_case.name << " (batch " << batch_size << "):" << std::endl;
+        trainer.getMemoryPlan().print();
+    }
+}
+
+std::string Benchmark::defaultMachineClass() {
+    std::string arch = "unknown";
+#if defined(__x86_64__) || defined(_M_X64)
+    arch = "x86_64";
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    arch = "arm64";
+#endif
+    std::string os = "unknown";
+#if defined(__APPLE__)
+    os = "macos";
+#elif defined(__linux__)
+    os = "linux";
+#elif defined(_WIN32)
+    os = "windows";
+#endif
+#ifdef NDEBUG
+    std::string build = "release";
+#else
+    std::string build = "debug"; // unoptimized numbers are never compared against optimized ones
+#endif
+    return arch + "-" + os + "-" + build;
+}
+
+bool Benchmark::saveBaseline(const std::string& path, const std::string& machine_class, const std::map<std::string, double>& results) {
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Cannot write baseline file: " << path << std::endl;
+        return false;
+    }
+    file << "{\n  \"machine_class\": \"" << machine_class << "\",\n  \"unit\": \"samples_per_sec\",\n  \"results\": {\n";
+    file << std::setprecision(6);
+    size_t i = 0;
+    for (const auto& [metric, throughput] : results) {
+        file << "    \"" << metric << "\": " << throughput << (++i < results.size() ? ",\n" : "\n");
+    }
+    file << "  }\n}\n";
+    return true;
+}
+
+bool Benchmark::loadBaseline(const std::string& path, std::map<std::string, double>& results) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot read baseline file: " << path << std::endl;
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string json = buffer.str();
+
+    size_t results_pos = json.find("\"results\"");
+    if (results_pos == std::string::npos) {
+        std::cerr << "Baseline file has no \"results\" object: " << path << std::endl;
+        return false;
+    }
+    std::regex entry("\"([^\"]+)\"\\s*:\\s*([-+0-9.eE]+)");
+    for (std::sregex_iterator it(json.begin() + results_pos, json.end(), entry), end; it != end; ++it) {
+        results[(*it)[1]] = std::stod((*it)[2]);
+    }
+    return true;
+}
+
+int Benchmark::compare(const std::map<std::string, double>& baseline, const std::map<std::string, double>& current, double tolerance) {
+    // the table is formatted in a local stream, so std::cout's flags and precision are left as they were
+    int regressions = 0;
+    std::ostringstream table;
+    table << std::left << std::setw(28) << "metric" << std::right
+          << std::setw(14) << "baseline" << std::setw(14) << "current" << std::setw(10) << "change" << "\n";
+    for (const auto& [metric, throughput] : current) {
+        auto it = baseline.find(metric);
+        table << std::left << std::setw(28) << metric << std::right << std::scientific << std::setprecision(3);
+        if (it == baseline.end()) {
+            table << std::setw(14) << "-" << std::setw(14) << throughput << std::setw(10) << "new" << "\n";
+            continue;
+        }
+        double change = (throughput - it->second) / it->second;
+        table << std::setw(14) << it->second << std::setw(14) << throughput
+              << std::fixed << std::setprecision(1) << std::setw(9) << change * 100 << "%";
+        if (change < -tolerance) {
+            table << "  REGRESSION";
+            ++regressions;
+        }
+        table << "\n";
+    }
+    for (const auto& [metric, throughput] : baseline) {
+        if (current.find(metric) == current.end()) { // a metric that stopped being measured can't be trusted either
+            table << std::left << std::setw(28) << metric << "missing from current run  REGRESSION" << "\n";
+            ++regressions;
+        }
+    }
+    std::cout << table.str() << std::flush;
+    return regressions;
+}
@@ -0,0 +1,54 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "utility.h"
+
+struct BenchmarkCase {
+    std::string name;
+    unsigned int input_size;
+    std::vector<std::pair<int, ActivationType>> layers; // (size, activation) for every layer, in order
+    LossFxn loss_fxn;
+    unsigned int sample_size; // number of synthetic samples
+    int fit_epochs;
+};
+
+class Benchmark {
+    std::vector<BenchmarkCase> cases;
+    double min_seconds; // each metric is measured for at least this long
+    int repetitions; // best of n runs is reported
+
+public:
+    Benchmark()
+        : min_seconds(0.2), repetitions(3) {
+    }
+
+    void addCase(const BenchmarkCase&);
+    void addDefaultCases();
+    void setMinSeconds(double);
+    void setRepetitions(int);
+
+    // metric name ("<case>.forward", "<case>.backward", "<case>.fit") -> throughput in samples/sec
+    std::map<std::string, double> run() const;
+    // per layer flop/byte roofline report of every case against the measured machine peak
+    void printRooflineReports() const;
+    // asserts that forward, backward and update steps don't allocate after warm-up (needs NN_TRACK_ALLOCATIONS)
+    bool verifyAllocationFreeSteps() const;
+    // buffer offsets and peak arena size of every case's BatchedTrainer step
+    void printMemoryPlans(size_t batch_size = 64, size_t checkpoint_every = 0) const;
+
+    static std::string defaultMachineClass();
+    static bool saveBaseline(const std::string& path, const std::string& machine_class, const std::map<std::string, double>& results);
+    static bool loadBaseline(const std::string& path, std::map<std::string, double>& results);
+    // prints a diff table and returns the number of metrics whose throughput dropped more than tolerance (0.1 = 10%),
+    // plus the baseline metrics missing from the current run
+    static int compare(const std::map<std::string, double>& baseline, const std::map<std::string, double>& current, double tolerance);
+};
+
+#endif //BENCHMARK_H
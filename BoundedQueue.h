@@ -0,0 +1,41 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// Blocking FIFO between two threads with at most `capacity` items in flight: push waits while it's full,
+// pop while it's empty, so a fast producer can't run arbitrarily far ahead of its consumer.
+template <typename T>
+class BoundedQueue {
+    std::deque<T> items;
+    size_t capacity;
+    std::mutex mtx;
+    std::condition_variable not_full, not_empty;
+
+public:
+    explicit BoundedQueue(size_t _capacity = 1) : capacity(_capacity ? _capacity : 1) {}
+
+    void push(T item) {
+        std::unique_lock<std::mutex> lock(mtx);
+        not_full.wait(lock, [this] { return items.size() < capacity; });
+        items.push_back(std::move(item));
+        not_empty.notify_one();
+    }
+
+    T pop() {
+        std::unique_lock<std::mutex> lock(mtx);
+        not_empty.wait(lock, [this] { return !items.empty(); });
+        T item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return item;
+    }
+};
+
+#endif //BOUNDEDQUEUE_H
@@ -0,0 +1,108 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#include "Checkpoint.h"
+#include "NeuralNetwork.h"
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+
+CheckpointWriter::CheckpointWriter(std::string _path) : path(std::move(_path)) {
+    writer = std::thread(&CheckpointWriter::writeLoop, this);
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true; // the queued snapshot is still written
+    }
+    queued_cv.notify_one();
+    writer.join();
+}
+
+void CheckpointWriter::snapshot(unsigned int input_size, const std::vector<Layer>& layers, const TrainingState& state) {
+    int target;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        target = writing == 0 ? 1 : 0; // the buffer the writer doesn't read. a queued, unwritten snapshot there is replaced
+        if (pending == target) pending = -1;
+    }
+    Snapshot& snapshot = snapshots[target];
+    snapshot.input_size = input_size;
+    snapshot.layers = layers;
+    snapshot.state = state;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        pending = target; // an older one still queued in the other buffer is dropped
+    }
+    queued_cv.notify_one();
+}
+
+void CheckpointWriter::writeLoop() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        queued_cv.wait(lock, [this] { return pending >= 0 || stopping; });
+        if (pending < 0) return;
+        writing = pending;
+        pending = -1;
+        lock.unlock();
+        const Snapshot& snapshot = snapshots[writing];
+        bool ok = writeCheckpoint(path, snapshot.input_size, snapshot.layers, snapshot.state);
+        lock.lock();
+        if (!ok) failed = true;
+        writing = -1;
+        idle_cv.notify_all();
+    }
+}
+
+bool CheckpointWriter::wait() {
+    std::unique_lock<std::mutex> lock(mtx);
+    idle_cv.wait(lock, [this] { return pending < 0 && writing < 0; });
+    return !failed;
+}
+
+bool writeCheckpoint(const std::string& path, unsigned int input_size, const std::vector<Layer>& layers, const TrainingState& state) {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary);
+        if (!file) {
+            std::cerr << "Cannot write checkpoint file: " << temporary << std::endl;
+            return false;
+        }
+        file << std::setprecision(17);
+        file << "NNCHECKPOINT 1\n" << state.next_epoch << " " << state.learning_rate << " "
+             << state.gradient_descent_type << " " << state.mini_batch_size << "\n" << state.rng << "\n";
+        NeuralNetwork::writeModel(file, input_size, layers);
+        file.flush();
+        if (!file) {
+            std::cerr << "Cannot write checkpoint file: " << temporary << std::endl;
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::cerr << "Cannot replace checkpoint file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool readCheckpoint(const std::string& path, unsigned int& input_size, std::vector<Layer>& layers, TrainingState& state) {
+    std::ifstream file(path);
+    std::string magic;
+    int version = 0, descent_type = 0;
+    TrainingState _state;
+    if (!(file >> magic >> version) || magic != "NNCHECKPOINT" || version != 1) {
+        std::cerr << "Not a checkpoint file: " << path << std::endl;
+        return false;
+    }
+    if (!(file >> _state.next_epoch >> _state.learning_rate >> descent_type >> _state.mini_batch_size >> _state.rng)
+        || descent_type < SGD || descent_type > Batch || _state.next_epoch < 0) {
+        std::cerr << "Corrupt checkpoint file: " << path << std::endl;
+        return false;
+    }
+    _state.gradient_descent_type = static_cast<GradientDescentType>(descent_type);
+    if (!NeuralNetwork::readModel(file, path, input_size, layers)) return false;
+    state = _state;
+    return true;
+}
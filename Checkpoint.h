@@ -0,0 +1,65 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Layer.h"
+#include "utility.h"
+
+// what fit needs besides the weights to carry on where it stopped. plain gradient descent keeps no other
+// optimizer state than its settings
+struct TrainingState {
+    int next_epoch = 0;
+    double learning_rate = 0.05;
+    GradientDescentType gradient_descent_type = Batch;
+    double mini_batch_size = 0.1;
+    std::mt19937 rng; // sample shuffling
+};
+
+// Writes checkpoints from its own thread while training goes on. snapshot() copies the layers into one of two
+// buffers (copy-assigning the same shapes reuses their memory) and returns; the writer thread formats and writes
+// it. If it is still busy with the previous checkpoint, the new one waits in the other buffer, and a newer snapshot
+// replaces it there, so training never waits on the disk. The writer is a dedicated thread, not a ThreadPool task:
+// that would wait for a free worker (forever without any) and could run on a training thread waiting on the pool.
+// Each file is written next to the target and renamed over it, so a crash mid-write leaves the previous
+// checkpoint intact. The destructor waits for the writes.
+class CheckpointWriter {
+    struct Snapshot {
+        unsigned int input_size = 0;
+        std::vector<Layer> layers;
+        TrainingState state;
+    };
+    std::string path;
+    Snapshot snapshots[2];
+    int writing = -1, pending = -1; // snapshot index, -1 = none
+    bool failed = false;
+    bool stopping = false;
+    std::mutex mtx;
+    std::condition_variable queued_cv, idle_cv;
+    std::thread writer;
+
+    void writeLoop();
+
+public:
+    explicit CheckpointWriter(std::string path);
+    ~CheckpointWriter();
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    void snapshot(unsigned int input_size, const std::vector<Layer>& layers, const TrainingState& state);
+    bool wait(); // until everything snapshotted is on disk, false if a write failed
+};
+
+// a checkpoint file: the training state, then the model in saveModel's format
+bool writeCheckpoint(const std::string& path, unsigned int input_size, const std::vector<Layer>& layers, const TrainingState& state);
+bool readCheckpoint(const std::string& path, unsigned int& input_size, std::vector<Layer>& layers, TrainingState& state);
+
+#endif //CHECKPOINT_H
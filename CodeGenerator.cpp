@@ -0,0 +1,140 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#include "CodeGenerator.h"
+#include "NeuralNetwork.h"
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    bool isIdentifier(const std::string& name) {
+        if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) return false;
+        for (char c : name) {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') return false;
+        }
+        return true;
+    }
+
+    const char* activationName(ActivationType type) {
+        switch (type) {
+            case LINEAR: return "LINEAR";
+            case SIGMOID: return "SIGMOID";
+            case RELU: return "RELU";
+            case TANH: return "TANH";
+            case SOFTMAX: return "SOFTMAX";
+        }
+        return "?";
+    }
+
+    void writeArray(std::ostream& out, const std::string& name, const std::vector<double>& values) {
+        out << "alignas(64) static constexpr double " << name << "[" << values.size() << "] = {";
+        for (size_t i=0; i<values.size(); ++i) {
+            out << (i % 4 == 0 ? "\n    " : " ") << values[i] << ",";
+        }
+        out << "\n};\n";
+    }
+
+    // z = W a + b, then the activation in place, for one layer with all sizes as literals
+    void writeLayer(std::ostream& out, size_t l, size_t m, size_t n, ActivationType type,
+                    const std::string& input, const std::string& output) {
+        std::string w = "layer" + std::to_string(l) + "_weights", b = "layer" + std::to_string(l) + "_bias";
+        out << "    // layer " << l << ": " << n << " -> " << m << ", " << activationName(type) << "\n"
+            << "    for (std::size_t i = 0; i < " << m << "; ++i) {\n"
+            << "        double z = 0;\n"
+            << "        for (std::size_t j = 0; j < " << n << "; ++j) z += " << w << "[i * " << n << " + j] * " << input << "[j];\n"
+            << "        z += " << b << "[i];\n";
+        switch (type) {
+            case SIGMOID: out << "        " << output << "[i] = 1.0 / (1.0 + std::exp(-z));\n"; break;
+            case RELU: out << "        " << output << "[i] = z > 0 ? z : 0.0;\n"; break;
+            case TANH: out << "        " << output << "[i] = std::tanh(z);\n"; break;
+            default: out << "        " << output << "[i] = z;\n"; break;
+        }
+        out << "    }\n";
+        if (type == SOFTMAX) {
+            out << "    {\n"
+                << "        double max_logit = " << output << "[0];\n"
+                << "        for (std::size_t i = 1; i < " << m << "; ++i) max_logit = " << output << "[i] > max_logit ? " << output << "[i] : max_logit;\n"
+                << "        double sum = 0;\n"
+                << "        for (std::size_t i = 0; i < " << m << "; ++i) sum += " << output << "[i] = std::exp(" << output << "[i] - max_logit);\n"
+                << "        for (std::size_t i = 0; i < " << m << "; ++i) " << output << "[i] /= sum;\n"
+                << "    }\n";
+        }
+    }
+}
+
+std::string generateInferenceSource(const NeuralNetwork& net, const std::string& model_name) {
+    const auto& layers = net.getLayerReadOnly();
+    for (size_t l=0; l<layers.size(); ++l) { // the generated code is dense doubles with the exact activations
+        if (layers[l].getWeightPrecision() != FullPrecision || layers[l].getActivationAccuracy() != Exact || layers[l].isInferenceOnly()) {
+            std::cerr << "Error: layer " << l << " uses 16-bit weights or approximate activations, "
+                      << "the generated source only runs full precision and exact activations" << std::endl;
+            return "";
+        }
+        if (!layers[l].getWeightMask().empty() || layers[l].usesSparseKernels()) {
+            std::cerr << "Warning: layer " << l << " is pruned, the generated source runs it dense" << std::endl;
+        }
+    }
+    std::string guard = model_name;
+    for (char& c : guard) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    guard += "_GENERATED_H";
+
+    std::ostringstream out;
+    out.precision(17);
+    out << "// Generated from a trained NeuralNetwork by exportInferenceSource, do not edit.\n"
+        << "// " << net.getInputSize();
+    for (const auto& layer : layers) out << " -> " << layer.getNeuronCount() << " " << activationName(layer.getActivationType());
+    out << "\n\n#ifndef " << guard << "\n#define " << guard << "\n\n#include <cmath>\n#include <cstddef>\n\n"
+        << "namespace " << model_name << " {\n\n"
+        << "constexpr std::size_t input_size = " << net.getInputSize() << ";\n"
+        << "constexpr std::size_t output_size = " << (layers.empty() ? 0 : layers.back().getNeuronCount()) << ";\n\n";
+
+    std::vector<double> weights, bias;
+    for (size_t l=0; l<layers.size(); ++l) {
+        weights.clear();
+        bias.clear();
+        for (const auto& neuron : layers[l].getNeuronsReadOnly()) { // row-major, one row per neuron
+            weights.insert(weights.end(), neuron.weights.begin(), neuron.weights.end());
+            bias.push_back(neuron.bias);
+        }
+        writeArray(out, "layer" + std::to_string(l) + "_weights", weights);
+        writeArray(out, "layer" + std::to_string(l) + "_bias", bias);
+        out << "\n";
+    }
+
+    out << "// input[input_size] -> output[output_size]; no allocation, intermediate activations are on the stack\n"
+        << "inline void predict(const double* input, double* output) {\n";
+    for (size_t l=0; l+1<layers.size(); ++l) {
+        out << "    alignas(64) double a" << l << "[" << layers[l].getNeuronCount() << "];\n";
+    }
+    for (size_t l=0; l<layers.size(); ++l) {
+        std::string input = l == 0 ? "input" : "a" + std::to_string(l-1);
+        std::string output = l + 1 == layers.size() ? "output" : "a" + std::to_string(l);
+        writeLayer(out, l, layers[l].getNeuronCount(), layers[l].getInputCount(), layers[l].getActivationType(),
+                   input, output);
+    }
+    out << "}\n\n} // namespace " << model_name << "\n\n#endif // " << guard << "\n";
+    return out.str();
+}
+
+bool exportInferenceSource(const NeuralNetwork& net, const std::string& path, const std::string& model_name) {
+    if (!isIdentifier(model_name)) {
+        std::cerr << "Error: model name must be a C++ identifier: " << model_name << std::endl;
+        return false;
+    }
+    if (net.getLayerReadOnly().empty()) {
+        std::cerr << "Error: cannot export a network without layers" << std::endl;
+        return false;
+    }
+    std::string source = generateInferenceSource(net, model_name);
+    if (source.empty()) return false;
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Cannot write source file: " << path << std::endl;
+        return false;
+    }
+    file << source;
+    return static_cast<bool>(file);
+}
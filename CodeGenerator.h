@@ -0,0 +1,24 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef CODEGENERATOR_H
+#define CODEGENERATOR_H
+
+#include <string>
+
+class NeuralNetwork;
+
+// Writes a trained network as one self-contained C++ header: the weights as alignas(64) static constexpr arrays
+// and a `void predict(const double* input, double* output)` with the topology and activations spelled out,
+// inside `namespace model_name`. The header only includes <cmath> and <cstddef> and builds as C++11, so the
+// model can be compiled into a binary without this library, SFML or a model file. Activations are the exact
+// ones, weights are printed with 17 digits so they round-trip, and predictions match NeuralNetwork::predict.
+// The arrays have internal linkage: include the header in one translation unit if the model is large.
+// Empty for a network with 16-bit weights or approximate activations, which the header wouldn't reproduce;
+// pruned layers are written dense (with a warning)
+std::string generateInferenceSource(const NeuralNetwork&, const std::string& model_name);
+// false if model_name isn't a C++ identifier, the source can't be generated or the file can't be written
+bool exportInferenceSource(const NeuralNetwork&, const std::string& path, const std::string& model_name);
+
+#endif //CODEGENERATOR_H
@@ -0,0 +1,28 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef COMMUNICATOR_H
+#define COMMUNICATOR_H
+
+#include <cstddef>
+
+// Collective operations between the replicas (ranks) of a data-parallel training run, see
+// NeuralNetwork::setCommunicator. Every rank must make the same calls in the same order with the same counts.
+class Communicator {
+public:
+    virtual ~Communicator() = default;
+    virtual size_t rank() const = 0;
+    virtual size_t size() const = 0; // number of ranks
+    // element-wise sum over all ranks, in place; every rank ends up with the same values.
+    // false if a peer didn't take part (timeout or error), values are then unspecified
+    virtual bool allReduce(double* values, size_t count) = 0;
+    // allReduce for gradients, where a transport may trade exactness for traffic (TcpCommunicator's compression).
+    // stream tells the gradient buffers apart from step to step, for transports that keep state per buffer.
+    // every rank still ends up with the same values
+    virtual bool allReduceGradients(double* values, size_t count, size_t /*stream*/) {
+        return allReduce(values, count);
+    }
+};
+
+#endif //COMMUNICATOR_H
@@ -0,0 +1,68 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef FASTMATH_H
+#define FASTMATH_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Approximate exp / sigmoid / tanh for the Polynomial and LookupTable activation accuracy modes. Branch-free
+// and inline, so loops over whole rows (Layer::activateBatch) vectorize.
+
+// e^x = 2^n * e^r with x = n*ln2 + r, |r| <= ln2/2, e^r by its degree 7 Taylor polynomial:
+// relative error below 1e-8 over the clamped range [-708, 708]. n is rounded by adding 1.5 * 2^52, which leaves
+// it in the low mantissa bits, so no float -> int conversion is needed and the whole thing stays in SIMD lanes
+inline double fastExp(double x) {
+    x = x < -708.0 ? -708.0 : x;
+    x = x > 708.0 ? 708.0 : x;
+    const double log2e = 1.4426950408889634, ln2_hi = 0.6931471803691238, ln2_lo = 1.9082149292705877e-10;
+    const double round_magic = 6755399441055744.0; // 1.5 * 2^52
+    double shifted = x * log2e + round_magic;
+    double n = shifted - round_magic;
+    double r = (x - n * ln2_hi) - n * ln2_lo;
+    double p = 1.0 + r * (1.0 + r * (1.0 / 2 + r * (1.0 / 6 + r * (1.0 / 24 + r * (1.0 / 120
+               + r * (1.0 / 720 + r * (1.0 / 5040)))))));
+    uint64_t n_bits, magic_bits;
+    std::memcpy(&n_bits, &shifted, sizeof(n_bits));
+    std::memcpy(&magic_bits, &round_magic, sizeof(magic_bits));
+    uint64_t scale_bits = (n_bits - magic_bits + 1023) << 52; // 2^n
+    double scale;
+    std::memcpy(&scale, &scale_bits, sizeof(scale));
+    return p * scale;
+}
+
+inline double fastSigmoid(double x) {
+    return 1.0 / (1.0 + fastExp(-x));
+}
+
+inline double fastTanh(double x) {
+    x = x < -20.0 ? -20.0 : x; // tanh(20) is 1 in double
+    x = x > 20.0 ? 20.0 : x;
+    return 1.0 - 2.0 / (fastExp(2 * x) + 1.0);
+}
+
+// linear interpolation in a table of f over [-range, range], clamped to the end values outside.
+// 8192 entries: interpolation error below 1e-6 for sigmoid and tanh
+class ActivationTable {
+    static const int size = 8192;
+    double range, step_inverse;
+    double values[size + 1];
+
+public:
+    ActivationTable(double (*f)(double), double _range) : range(_range), step_inverse(size / (2 * _range)) {
+        for (int i=0; i<=size; ++i) values[i] = f(-range + i / step_inverse);
+    }
+
+    double operator()(double x) const {
+        double position = (std::min(std::max(x, -range), range) + range) * step_inverse;
+        int i = std::min(static_cast<int>(position), size - 1);
+        double t = position - i;
+        return values[i] + t * (values[i+1] - values[i]);
+    }
+};
+
+#endif //FASTMATH_H
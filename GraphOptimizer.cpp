@@ -0,0 +1,67 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#include "GraphOptimizer.h"
+#include "NeuralNetwork.h"
+
+bool FoldLinearLayersPass::run(std::vector<Layer>& layers, unsigned int input_size) {
+    bool changed = false;
+    for (size_t l=0; l+1<layers.size();) {
+        const Layer& first = layers[l];
+        const Layer& second = layers[l+1];
+        double n = l == 0 ? input_size : layers[l-1].getNeuronCount();
+        double m1 = first.getNeuronCount(), m2 = second.getNeuronCount();
+        if (first.getActivationType() != LINEAR || first.isInferenceOnly() || second.isInferenceOnly() || n*m2 >= n*m1 + m1*m2) {
+            ++l;
+            continue;
+        }
+
+        const auto& A = first.getNeuronsReadOnly(); // m1 x n
+        const auto& B = second.getNeuronsReadOnly(); // m2 x m1
+        Layer folded(static_cast<unsigned int>(n), static_cast<unsigned int>(m2), second.getActivationType());
+        auto& neurons = folded.getNeurons();
+        for (size_t i=0; i<m2; ++i) {
+            std::vector<double> weights(static_cast<size_t>(n), 0.0);
+            double bias = B[i].bias;
+            for (size_t k=0; k<m1; ++k) {
+                double b_ik = B[i].weights[k];
+                bias += b_ik * A[k].bias;
+                for (size_t j=0; j<n; ++j) {
+                    weights[j] += b_ik * A[k].weights[j];
+                }
+            }
+            neurons[i].initWeights(std::move(weights));
+            neurons[i].bias = bias;
+        }
+        layers[l] = std::move(folded);
+        layers.erase(layers.begin() + l + 1);
+        changed = true; // stay at l: the folded layer may fold with the next one too
+    }
+    return changed;
+}
+
+void GraphOptimizer::addPass(std::unique_ptr<GraphPass> pass) {
+    passes.push_back(std::move(pass));
+}
+
+void GraphOptimizer::addDefaultPasses() {
+    addPass(std::make_unique<FoldLinearLayersPass>());
+}
+
+NeuralNetwork GraphOptimizer::optimize(const NeuralNetwork& net, bool verbose) const {
+    NeuralNetwork optimized = net;
+    bool changed = true;
+    for (int round=0; changed && round<16; ++round) { // bounded in case two passes undo each other
+        changed = false;
+        for (const auto& pass : passes) {
+            if (pass->run(optimized.getLayers(), optimized.getInputSize())) {
+                changed = true;
+                if (verbose) {
+                    std::cout << pass->name() << ": " << optimized.getLayerReadOnly().size() << " layers left" << std::endl;
+                }
+            }
+        }
+    }
+    return optimized;
+}
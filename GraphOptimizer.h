@@ -0,0 +1,41 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef GRAPHOPTIMIZER_H
+#define GRAPHOPTIMIZER_H
+
+#include <memory>
+#include <vector>
+#include "Layer.h"
+
+class NeuralNetwork;
+
+// A rewrite over the layers of a trained network that keeps its predictions (up to rounding).
+class GraphPass {
+public:
+    virtual ~GraphPass() = default;
+    virtual const char* name() const = 0;
+    virtual bool run(std::vector<Layer>& layers, unsigned int input_size) = 0; // true if anything changed
+};
+
+// A LINEAR layer followed by any layer is one affine map: W = W2 * W1, b = W2 * b1 + b2, with the second
+// layer's activation. Folded only when the product needs fewer multiply-adds per sample than the pair.
+class FoldLinearLayersPass : public GraphPass {
+public:
+    const char* name() const override { return "fold-linear-layers"; }
+    bool run(std::vector<Layer>& layers, unsigned int input_size) override;
+};
+
+// Runs its passes over a copy of the network until none of them changes anything. The result is for
+// inference only (predict / predictBatch / serving), training it would train a different model.
+class GraphOptimizer {
+    std::vector<std::unique_ptr<GraphPass>> passes;
+
+public:
+    void addPass(std::unique_ptr<GraphPass>);
+    void addDefaultPasses();
+    NeuralNetwork optimize(const NeuralNetwork&, bool verbose = false) const;
+};
+
+#endif //GRAPHOPTIMIZER_H
@@ -0,0 +1,75 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef HALFPRECISION_H
+#define HALFPRECISION_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// 16-bit float encodings for packed weight storage. Inline because they sit in the inner loop of the dot products.
+// bfloat16 is the top half of a float (same range, 8 bit mantissa); float16 is IEEE half (range +-65504, 11 bit mantissa).
+// Both round to nearest even.
+
+inline uint32_t floatBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline float bitsToFloat(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline uint16_t toBFloat16(float value) {
+    uint32_t bits = floatBits(value);
+    if ((bits & 0x7fffffffu) > 0x7f800000u) {
+        return static_cast<uint16_t>((bits >> 16) | 0x40u); // keep NaN a (quiet) NaN, truncation could make it inf
+    }
+    bits += 0x7fffu + ((bits >> 16) & 1u);
+    return static_cast<uint16_t>(bits >> 16);
+}
+
+inline float fromBFloat16(uint16_t value) {
+    return bitsToFloat(static_cast<uint32_t>(value) << 16);
+}
+
+inline uint16_t toFloat16(float value) {
+    uint32_t bits = floatBits(value);
+    uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+    uint32_t half;
+    if (bits >= (127u + 16u) << 23) { // >= 65536: inf, or NaN
+        half = bits > 0x7f800000u ? 0x7e00u : 0x7c00u;
+    }
+    else if (bits < (127u - 14u) << 23) { // below the smallest normal half: let the float adder round the subnormal
+        const uint32_t magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+        half = floatBits(bitsToFloat(bits) + bitsToFloat(magic)) - magic;
+    }
+    else {
+        uint32_t mantissa_odd = (bits >> 13) & 1u;
+        bits += ((15u - 127u) << 23) + 0xfffu + mantissa_odd; // rebias the exponent and round, may carry into inf
+        half = bits >> 13;
+    }
+    return static_cast<uint16_t>(half | (sign >> 16));
+}
+
+inline float fromFloat16(uint16_t value) {
+    uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+    uint32_t exponent = (value >> 10) & 0x1fu;
+    uint32_t mantissa = value & 0x3ffu;
+    if (exponent == 0) { // zero or subnormal
+        float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -magnitude : magnitude;
+    }
+    if (exponent == 31) {
+        return bitsToFloat(sign | 0x7f800000u | (mantissa << 13));
+    }
+    return bitsToFloat(sign | ((exponent + 112u) << 23) | (mantissa << 13));
+}
+
+#endif //HALFPRECISION_H
@@ -0,0 +1,100 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#include "HyperparameterSweep.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    double rankingCost(double cost) { // a diverged run (NaN) ranks last
+        return std::isnan(cost) ? std::numeric_limits<double>::infinity() : cost;
+    }
+}
+
+HyperparameterSweep::HyperparameterSweep(const std::vector<std::vector<double>>& _X_train, const std::vector<std::vector<double>>& _Y_train,
+                                         const std::vector<std::vector<double>>& _X_validation, const std::vector<std::vector<double>>& _Y_validation,
+                                         const SweepOptions& _options)
+    : X_train(_X_train), Y_train(_Y_train), X_validation(_X_validation), Y_validation(_Y_validation), options(_options) {
+    options.min_epochs = std::max(options.min_epochs, 1);
+    options.max_epochs = std::max(options.max_epochs, options.min_epochs);
+    options.reduction_factor = std::max(options.reduction_factor, 1.5);
+}
+
+std::vector<SweepResult> HyperparameterSweep::run(const std::vector<SweepConfig>& configs) {
+    if (X_train.empty() || X_train.size() != Y_train.size() || X_validation.empty() || X_validation.size() != Y_validation.size()) {
+        std::cerr << "Error: sweep needs matching, non-empty training and validation sets" << std::endl;
+        return {};
+    }
+    std::vector<SweepResult> results;
+    for (const auto& config : configs) {
+        if (config.layer_sizes.empty() || *std::min_element(config.layer_sizes.begin(), config.layer_sizes.end()) < 1) {
+            std::cerr << "Error: sweep configuration without layers" << std::endl;
+            return {};
+        }
+        NeuralNetwork model;
+        for (size_t l=0; l<config.layer_sizes.size(); ++l) {
+            model.addLayer(config.layer_sizes[l], l+1 == config.layer_sizes.size() ? config.output_activation : config.hidden_activation);
+        }
+        model.setLearningRate(config.learning_rate);
+        model.setGradientDescentType(config.gradient_descent_type);
+        model.setMiniBatchSize(config.mini_batch_size);
+        model.setSeed(options.seed + static_cast<unsigned int>(results.size()));
+        model.setVerbose(false); // fits run concurrently
+        results.push_back({config, std::numeric_limits<double>::infinity(), 0, std::move(model)});
+    }
+
+    std::vector<size_t> survivors(results.size());
+    for (size_t i=0; i<survivors.size(); ++i) survivors[i] = i;
+    int trained = 0, target = options.min_epochs;
+    while (!survivors.empty()) {
+        // one task per configuration; each fit's own parallel loops share the same workers
+        ThreadPool::global().parallelFor(survivors.size(), [&](size_t k) {
+            SweepResult& result = results[survivors[k]];
+            if (trained > 0) result.model.resumeAt(trained);
+            result.model.fit(X_train, Y_train, target, options.loss_fxn);
+            result.cost = result.model.cost_compute(X_validation, Y_validation, options.loss_fxn);
+            result.epochs = target;
+        });
+        trained = target;
+        if (trained >= options.max_epochs || survivors.size() == 1) break;
+
+        std::stable_sort(survivors.begin(), survivors.end(), [&results](size_t a, size_t b) {
+            return rankingCost(results[a].cost) < rankingCost(results[b].cost);
+        });
+        size_t keep = static_cast<size_t>(std::ceil(static_cast<double>(survivors.size()) / options.reduction_factor));
+        survivors.resize(std::max<size_t>(keep, 1));
+        target = std::min(options.max_epochs, static_cast<int>(std::ceil(trained * options.reduction_factor)));
+    }
+
+    std::stable_sort(results.begin(), results.end(), [](const SweepResult& a, const SweepResult& b) {
+        if (a.epochs != b.epochs) return a.epochs > b.epochs;
+        return rankingCost(a.cost) < rankingCost(b.cost);
+    });
+    return results;
+}
+
+std::vector<SweepConfig> HyperparameterSweep::grid(const std::vector<std::vector<int>>& layer_sizes, const std::vector<double>& learning_rates,
+                                                   const std::vector<GradientDescentType>& gradient_descent_types,
+                                                   const std::vector<double>& mini_batch_sizes, const SweepConfig& base) {
+    std::vector<SweepConfig> configs;
+    std::vector<double> batch_sizes = mini_batch_sizes.empty() ? std::vector<double>{base.mini_batch_size} : mini_batch_sizes;
+    for (const auto& sizes : layer_sizes) {
+        for (double learning_rate : learning_rates) {
+            for (GradientDescentType type : gradient_descent_types) {
+                for (double mini_batch_size : batch_sizes) {
+                    SweepConfig config = base;
+                    config.layer_sizes = sizes;
+                    config.learning_rate = learning_rate;
+                    config.gradient_descent_type = type;
+                    config.mini_batch_size = mini_batch_size;
+                    configs.push_back(config);
+                    if (type != MiniBatch) break; // the batch size only matters for mini-batches
+                }
+            }
+        }
+    }
+    return configs;
+}
@@ -0,0 +1,63 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef HYPERPARAMETERSWEEP_H
+#define HYPERPARAMETERSWEEP_H
+
+#include <vector>
+#include "NeuralNetwork.h"
+#include "utility.h"
+
+struct SweepConfig {
+    std::vector<int> layer_sizes; // every layer after the input, the last one is the output
+    ActivationType hidden_activation = RELU;
+    ActivationType output_activation = LINEAR;
+    double learning_rate = 0.05;
+    GradientDescentType gradient_descent_type = MiniBatch;
+    double mini_batch_size = 0.1; // see setMiniBatchSize
+};
+
+struct SweepOptions {
+    int min_epochs = 10; // trained by every configuration before the first cut
+    int max_epochs = 90; // trained by the survivors
+    double reduction_factor = 3; // each rung keeps 1/factor of the configurations and trains them factor times longer
+    LossFxn loss_fxn = MSE;
+    unsigned int seed = 1; // configuration i shuffles its batches with seed + i
+};
+
+struct SweepResult {
+    SweepConfig config;
+    double cost; // on the validation set after epochs epochs
+    int epochs; // less than max_epochs when a rung cut it
+    NeuralNetwork model;
+};
+
+// Trains many configurations at once on the shared ThreadPool against one read-only dataset, instead of one process
+// (and one copy of the data) per configuration. Successive halving: every configuration trains min_epochs,
+// the best 1/reduction_factor by validation cost carry on to reduction_factor times as many epochs, and so on up to
+// max_epochs, so most of the time goes to the promising ones. Survivors continue their weights between rungs
+// (NeuralNetwork::resumeAt), which trains the same as one uninterrupted fit.
+// The sweep holds references to the data, keep it alive while run() goes.
+class HyperparameterSweep {
+    const std::vector<std::vector<double>>& X_train;
+    const std::vector<std::vector<double>>& Y_train;
+    const std::vector<std::vector<double>>& X_validation;
+    const std::vector<std::vector<double>>& Y_validation;
+    SweepOptions options;
+
+public:
+    HyperparameterSweep(const std::vector<std::vector<double>>& X_train, const std::vector<std::vector<double>>& Y_train,
+                        const std::vector<std::vector<double>>& X_validation, const std::vector<std::vector<double>>& Y_validation,
+                        const SweepOptions& = SweepOptions());
+
+    // every configuration with its validation cost and model, the ones that trained longest first, then by cost
+    std::vector<SweepResult> run(const std::vector<SweepConfig>& configs);
+
+    // every combination of the given values, with base's activations
+    static std::vector<SweepConfig> grid(const std::vector<std::vector<int>>& layer_sizes, const std::vector<double>& learning_rates,
+                                         const std::vector<GradientDescentType>& gradient_descent_types,
+                                         const std::vector<double>& mini_batch_sizes, const SweepConfig& base = SweepConfig());
+};
+
+#endif //HYPERPARAMETERSWEEP_H
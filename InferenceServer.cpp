@@ -0,0 +1,244 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#include "InferenceServer.h"
+#include "NeuralNetwork.h"
+#include "ModelHandle.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+#ifdef MSG_NOSIGNAL
+    const int send_flags = MSG_NOSIGNAL; // a client hanging up must not SIGPIPE the server
+#else
+    const int send_flags = 0;
+#endif
+    const uint32_t max_values = 1u << 24; // sanity limit on a single message
+
+    bool readAll(int fd, void* data, size_t size) {
+        auto* ptr = static_cast<char*>(data);
+        while (size > 0) {
+            ssize_t n = recv(fd, ptr, size, 0);
+            if (n <= 0) return false;
+            ptr += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    bool writeAll(int fd, const void* data, size_t size) {
+        auto* ptr = static_cast<const char*>(data);
+        while (size > 0) {
+            ssize_t n = send(fd, ptr, size, send_flags);
+            if (n <= 0) return false;
+            ptr += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    bool writeMessage(int fd, const std::vector<double>& values) {
+        uint32_t count = static_cast<uint32_t>(values.size());
+        return writeAll(fd, &count, sizeof(count)) && writeAll(fd, values.data(), count * sizeof(double));
+    }
+
+    bool readMessage(int fd, std::vector<double>& values) {
+        uint32_t count;
+        if (!readAll(fd, &count, sizeof(count)) || count > max_values) return false;
+        values.resize(count);
+        return readAll(fd, values.data(), count * sizeof(double));
+    }
+
+    bool makeAddress(const std::string& path, sockaddr_un& address) {
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            std::cerr << "Socket path too long: " << path << std::endl;
+            return false;
+        }
+        std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        return true;
+    }
+}
+
+InferenceServer::InferenceServer(const NeuralNetwork& _model, std::string _socket_path, size_t _max_batch_size, unsigned int max_wait_us)
+    : model(&_model), model_handle(nullptr), socket_path(std::move(_socket_path)), max_batch_size(std::max<size_t>(_max_batch_size, 1)),
+      max_wait(max_wait_us), listen_fd(-1), running(false) {
+}
+
+InferenceServer::InferenceServer(ModelHandle& _model_handle, std::string _socket_path, size_t _max_batch_size, unsigned int max_wait_us)
+    : model(nullptr), model_handle(&_model_handle), socket_path(std::move(_socket_path)), max_batch_size(std::max<size_t>(_max_batch_size, 1)),
+      max_wait(max_wait_us), listen_fd(-1), running(false) {
+}
+
+InferenceServer::~InferenceServer() {
+    stop();
+}
+
+bool InferenceServer::start() {
+    sockaddr_un address;
+    if (running || !makeAddress(socket_path, address)) return false;
+
+    unlink(socket_path.c_str()); // stale socket of a previous run
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0 || bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listen_fd, 64) != 0) {
+        std::cerr << "Cannot listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+        if (listen_fd >= 0) close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    running = true;
+    batch_thread = std::thread(&InferenceServer::batchLoop, this);
+    accept_thread = std::thread(&InferenceServer::acceptLoop, this);
+    return true;
+}
+
+void InferenceServer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mtx);
+        if (!running) return;
+        running = false; // submit refuses new work from here on, the batcher drains what's queued
+    }
+    queue_cv.notify_all();
+
+    shutdown(listen_fd, SHUT_RDWR); // wakes up accept
+    if (accept_thread.joinable()) accept_thread.join();
+    close(listen_fd);
+    listen_fd = -1;
+    unlink(socket_path.c_str());
+
+    {
+        std::lock_guard<std::mutex> lock(connections_mtx);
+        for (auto& connection : connections) {
+            if (!connection.finished) shutdown(connection.fd, SHUT_RDWR); // wakes up blocking reads
+        }
+    }
+    for (auto& connection : connections) {
+        connection.thread.join();
+    }
+    connections.clear();
+    if (batch_thread.joinable()) batch_thread.join();
+}
+
+std::vector<double> InferenceServer::submit(const std::vector<double>& input_vector) {
+    std::vector<double> output; // stays empty if the input doesn't fit the model its batch ran on
+    PendingRequest request{&input_vector, &output, false};
+    std::unique_lock<std::mutex> lock(queue_mtx);
+    if (!running) return output;
+    queue.push_back(&request);
+    queue_cv.notify_one();
+    done_cv.wait(lock, [&request] { return request.done; });
+    return output;
+}
+
+void InferenceServer::acceptLoop() {
+    while (running) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) continue; // stop() shut the socket down, or a transient error
+        std::lock_guard<std::mutex> lock(connections_mtx);
+        for (auto it = connections.begin(); it != connections.end();) { // reap closed connections
+            if (it->finished) {
+                it->thread.join();
+                it = connections.erase(it);
+            }
+            else ++it;
+        }
+        if (!running) {
+            close(fd);
+            break;
+        }
+        connections.push_back({fd, false, std::thread()});
+        Connection& connection = connections.back();
+        connection.thread = std::thread(&InferenceServer::connectionLoop, this, std::ref(connection));
+    }
+}
+
+void InferenceServer::connectionLoop(Connection& connection) {
+    std::vector<double> input;
+    while (readMessage(connection.fd, input)) {
+        if (!writeMessage(connection.fd, submit(input))) break;
+    }
+    std::lock_guard<std::mutex> lock(connections_mtx);
+    close(connection.fd);
+    connection.finished = true;
+}
+
+void InferenceServer::batchLoop() {
+    std::vector<PendingRequest*> batch;
+    std::vector<PendingRequest*> valid;
+    std::vector<double> input_vectors;
+
+    std::unique_lock<std::mutex> lock(queue_mtx);
+    while (true) {
+        queue_cv.wait(lock, [this] { return !queue.empty() || !running; });
+        if (queue.empty()) return; // stopped and drained
+
+        // give the batch until max_wait to fill up, a full batch goes right away
+        queue_cv.wait_for(lock, max_wait, [this] { return queue.size() >= max_batch_size || !running; });
+        size_t batch_size = std::min(queue.size(), max_batch_size);
+        batch.assign(queue.begin(), queue.begin() + batch_size);
+        queue.erase(queue.begin(), queue.begin() + batch_size);
+        lock.unlock();
+
+        {
+            // the whole batch runs on one model; with a handle a concurrent swap waits for this batch to finish
+            std::unique_ptr<ModelHandle::ReadGuard> guard;
+            if (model_handle) guard = std::make_unique<ModelHandle::ReadGuard>(*model_handle);
+            const NeuralNetwork& batch_model = guard ? **guard : *model;
+            size_t input_n = batch_model.getInputSize();
+
+            valid.clear();
+            for (auto* request : batch) {
+                if (request->input->size() == input_n) valid.push_back(request);
+            }
+            input_vectors.resize(valid.size() * input_n);
+            for (size_t b=0; b<valid.size(); ++b) {
+                std::copy(valid[b]->input->begin(), valid[b]->input->end(), input_vectors.begin() + b*input_n);
+            }
+            if (!valid.empty()) {
+                std::vector<double> outputs = batch_model.predictBatch(input_vectors.data(), valid.size());
+                size_t output_n = outputs.size() / valid.size();
+                for (size_t b=0; b<valid.size(); ++b) {
+                    valid[b]->output->assign(outputs.begin() + b*output_n, outputs.begin() + (b+1)*output_n);
+                }
+            }
+        }
+
+        lock.lock();
+        for (auto* request : batch) request->done = true;
+        done_cv.notify_all();
+    }
+}
+
+InferenceClient::InferenceClient(const std::string& socket_path)
+    : fd(-1) {
+    sockaddr_un address;
+    if (!makeAddress(socket_path, address)) return;
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "Cannot connect to " << socket_path << ": " << std::strerror(errno) << std::endl;
+        close(fd);
+        fd = -1;
+    }
+}
+
+InferenceClient::~InferenceClient() {
+    if (fd >= 0) close(fd);
+}
+
+bool InferenceClient::isConnected() const {
+    return fd >= 0;
+}
+
+std::vector<double> InferenceClient::predict(const std::vector<double>& input_vector) {
+    std::vector<double> output;
+    if (fd < 0 || !writeMessage(fd, input_vector) || !readMessage(fd, output)) output.clear();
+    return output;
+}
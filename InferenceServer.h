@@ -0,0 +1,90 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef INFERENCESERVER_H
+#define INFERENCESERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class NeuralNetwork;
+class ModelHandle;
+
+// Serves NeuralNetwork::predictBatch over a Unix domain socket.
+// Requests from all connections are queued and coalesced into one batched forward pass of up to max_batch_size
+// samples, waiting at most max_wait for the batch to fill after the first request arrived.
+//
+// Wire format (host byte order), same for request and response:
+//   uint32 value count, then that many float64
+// A response with count 0 means the request was rejected (wrong input size).
+// Constructed from a ModelHandle, every batch runs on the model current at that moment, so models can be
+// swapped in while serving.
+class InferenceServer {
+    struct PendingRequest {
+        const std::vector<double>* input;
+        std::vector<double>* output;
+        bool done;
+    };
+
+    const NeuralNetwork* model; // exactly one of model / model_handle is set
+    ModelHandle* model_handle;
+    std::string socket_path;
+    size_t max_batch_size;
+    std::chrono::microseconds max_wait;
+
+    int listen_fd;
+    std::atomic<bool> running;
+    std::thread accept_thread;
+    std::thread batch_thread;
+    struct Connection {
+        int fd;
+        bool finished;
+        std::thread thread;
+    };
+    std::mutex connections_mtx;
+    std::list<Connection> connections; // finished ones are joined on the next accept
+
+    std::mutex queue_mtx;
+    std::condition_variable queue_cv; // batcher waits for requests
+    std::condition_variable done_cv; // submitters wait for their result
+    std::deque<PendingRequest*> queue;
+
+    void acceptLoop();
+    void connectionLoop(Connection& connection);
+    void batchLoop();
+
+public:
+    InferenceServer(const NeuralNetwork& model, std::string socket_path, size_t max_batch_size = 32, unsigned int max_wait_us = 1000);
+    InferenceServer(ModelHandle& model_handle, std::string socket_path, size_t max_batch_size = 32, unsigned int max_wait_us = 1000);
+    ~InferenceServer();
+    InferenceServer(const InferenceServer&) = delete;
+    InferenceServer& operator=(const InferenceServer&) = delete;
+
+    bool start();
+    void stop();
+    // in-process entry point, also used by the socket connections: queues the sample and blocks until its batch ran
+    std::vector<double> submit(const std::vector<double>& input_vector);
+};
+
+// blocking client for InferenceServer, one request in flight per connection
+class InferenceClient {
+    int fd;
+public:
+    explicit InferenceClient(const std::string& socket_path);
+    ~InferenceClient();
+    InferenceClient(const InferenceClient&) = delete;
+    InferenceClient& operator=(const InferenceClient&) = delete;
+
+    bool isConnected() const;
+    std::vector<double> predict(const std::vector<double>& input_vector); // empty on error
+};
+
+#endif //INFERENCESERVER_H
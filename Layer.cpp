@@ -4,6 +4,47 @@
 
 #include "Layer.h"
 #include "utility.h"
+#include "HalfPrecision.h"
+#include "FastMath.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <unistd.h>
+
+namespace {
+    template <float (*decode)(uint16_t)>
+    float dotPacked(const uint16_t* weights, const double* input_vec, size_t input_n) {
+        float acc = 0;
+        for (size_t j=0; j<input_n; ++j) {
+            acc += static_cast<float>(input_vec[j]) * decode(weights[j]);
+        }
+        return acc;
+    }
+
+    size_t l2CacheBytes() {
+#ifdef _SC_LEVEL2_CACHE_SIZE
+        long bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+        if (bytes > 0) return static_cast<size_t>(bytes);
+#endif
+        return 1 << 20;
+    }
+
+    // body(begin, end) over [0, n) in blocks on the shared pool, or in one go when there's too little work to split.
+    // no state, so the const batch kernels stay safe to call from several threads. a template like forNeuronBlocks,
+    // so the unsplit path doesn't allocate
+    template <typename Body>
+    void parallelBlocks(size_t n, size_t work_per_item, const Body& body) {
+        ThreadPool& pool = ThreadPool::global();
+        const size_t min_block_work = 1 << 15; // multiply-adds that make a task worth it
+        size_t blocks = std::min(std::min(n, pool.size() * 4), n * work_per_item / min_block_work);
+        if (blocks < 2) {
+            body(0, n);
+            return;
+        }
+        size_t block = (n + blocks - 1) / blocks;
+        pool.parallelFor((n + block - 1) / block, [&](size_t b) { body(b*block, std::min(n, (b+1)*block)); });
+    }
+}
 
 Layer::Layer(unsigned int prev_n, unsigned int cur_n, ActivationType _activationType)
     : activationType(_activationType)
@@ -86,47 +127,409 @@ void Layer::set_a(const std::vector<double> &&new_as) {
     for(int i=0; i<neurons.size(); ++i) {
         neurons[i].a = new_as[i];
     }
+    updateActiveSet();
 }
 
 unsigned long Layer::getNeuronCount() const {
     return neurons.size();
 }
 
+unsigned long Layer::getInputCount() const {
+    if (inference_only) return input_count;
+    return neurons.empty() ? 0 : neurons[0].weights.size();
+}
+
+double Layer::flopCount(TrainingPhase phase, unsigned long next_n) const {
+    double n = getInputCount(), m = getNeuronCount();
+    double nm = sparse_kernels ? csr_values.size() : n*m; // weights actually visited
+    switch (phase) {
+        case ForwardPass:
+            return 2*nm + m + m; // dot products, bias, activation (counted as one op)
+        case BackwardPass:
+            // delta: dot product with the next layer's deltas (or loss derivative), weight/bias gradient: multiply, divide, add
+            return (next_n ? 2.0*next_n*m : 2*m) + m + 3*nm + 2*m;
+        case WeightUpdate:
+            return 2*nm + 2*m;
+        default:
+            return 0;
+    }
+}
+
+double Layer::byteCount(TrainingPhase phase, unsigned long next_n) const {
+    double n = getInputCount(), m = getNeuronCount();
+    const double w = sizeof(double);
+    switch (phase) {
+        case ForwardPass: // weights, bias, input activations, write z and a
+            if (sparse_kernels) return (w + sizeof(uint32_t)) * csr_values.size() + w * (m + n + 2*m);
+            return (weight_precision == FullPrecision ? w : sizeof(uint16_t)) * n*m + w * (m + n + 2*m);
+        case BackwardPass:
+            // next layer's weights and deltas, own z, write delta, read input activations, read+write gradients
+            return w * (next_n*m + next_n + 2*m + n + 2*n*m + 2*m);
+        case WeightUpdate:
+            return w * (3*n*m + 3*m); // read weight and gradient, write weight
+        default:
+            return 0;
+    }
+}
+
+template <typename Body>
+void Layer::forNeuronBlocks(const Body& body) {
+    size_t n = neurons.size(), input_n = getInputCount();
+    ThreadPool& pool = ThreadPool::global();
+    if (!tensor_parallel || pool.size() < 2 || n < 2) {
+        body(0, n);
+        return;
+    }
+    if (neuron_blocks.empty() || neuron_blocks.back() != n || blocks_input_n != input_n) {
+        // a block's weight and gradient rows fit in half the L2, and each thread gets at least one block
+        size_t row_bytes = 2 * input_n * sizeof(double) + 1;
+        size_t block = std::max<size_t>(1, l2CacheBytes() / 2 / row_bytes);
+        block = std::min(block, (n + pool.size() - 1) / pool.size());
+        neuron_blocks.clear();
+        for (size_t begin=0; begin<n; begin+=block) neuron_blocks.push_back(begin);
+        neuron_blocks.push_back(n);
+        blocks_input_n = input_n;
+    }
+    pool.parallelFor(neuron_blocks.size() - 1, [&](size_t b) { body(neuron_blocks[b], neuron_blocks[b+1]); });
+}
+
 void Layer::forward(const Layer& prev_layer) {
+    const auto& prevlayer_neurons = prev_layer.getNeuronsReadOnly();
+    if (!denseKernels()) {
+        input_buffer.resize(prevlayer_neurons.size());
+        for (size_t j=0; j<prevlayer_neurons.size(); ++j) {
+            input_buffer[j] = prevlayer_neurons[j].a;
+        }
+        forward(input_buffer.data(), input_buffer.size());
+        return;
+    }
+    if (prev_layer.sparseActivations()) { // only the active inputs contribute, skip the weight columns of the zeros
+        const auto& active = prev_layer.active_set;
+        z_buffer.resize(neurons.size());
+        forNeuronBlocks([&](size_t begin, size_t end) {
+            for (size_t i=begin; i<end; ++i) {
+                const double* w = neurons[i].weights.data();
+                double _z = 0;
+                for (uint32_t j : active) {
+                    _z += prevlayer_neurons[j].a * w[j];
+                }
+                z_buffer[i] = _z + neurons[i].bias;
+            }
+        });
+        activateZBuffer();
+        return;
+    }
+    if (activationType == SOFTMAX) {
+        compute_z_vector(prev_layer, z_buffer);
+        activateZBuffer();
+        return;
+    }
+    forNeuronBlocks([&](size_t begin, size_t end) {
+        for (size_t i=begin; i<end; ++i) {
+            neurons[i].computeOutput(prev_layer, activation_fxn);
+        }
+    });
+    updateActiveSet();
+}
+
+void Layer::forward(const double* input_vec, size_t input_n) {
+    if (activationType == SOFTMAX || !denseKernels()) {
+        compute_z_vector(input_vec, input_n, z_buffer);
+        activateZBuffer();
+        return;
+    }
+    forNeuronBlocks([&](size_t begin, size_t end) {
+        for (size_t i=begin; i<end; ++i) {
+            neurons[i].computeOutput(input_vec, input_n, activation_fxn);
+        }
+    });
+    updateActiveSet();
+}
+
+void Layer::activateZBuffer() {
+    for (size_t i=0; i<neurons.size(); ++i) {
+        neurons[i].z = z_buffer[i];
+    }
     if (activationType == SOFTMAX) {
-        std::vector<double> z = compute_z_vector(prev_layer);
-        set_z(std::move(z));
-        set_a(std::move(softmax(z)));
+        softmax(z_buffer, output_buffer);
+        for (size_t i=0; i<neurons.size(); ++i) {
+            neurons[i].a = output_buffer[i];
+        }
         return;
     }
     for (auto& neuron : neurons) {
-        neuron.computeOutput(prev_layer, activation_fxn);
+        neuron.a = activation_fxn(neuron.z);
     }
+    updateActiveSet();
 }
 
-std::vector<double> Layer::compute_z_vector(const Layer &prev_layer) {
-    std::vector<double> z(neurons.size());
-    const auto& prevlayer_neurons = prev_layer.getNeuronsReadOnly();
+void Layer::updateActiveSet() {
+    if (activationType != RELU) return;
+    active_set.clear(); // keeps its capacity, no allocation after the first sample
+    for (size_t i=0; i<neurons.size(); ++i) {
+        if (neurons[i].a > 0) active_set.push_back(static_cast<uint32_t>(i));
+    }
+    if (track_activations) {
+        ++tracked_samples;
+        for (uint32_t i : active_set) ++activation_counts[i];
+    }
+}
 
-    for(int i=0; i<neurons.size(); ++i) {
-        double _z = 0;
-        int j = 0;
-        for (const auto& neuron : prevlayer_neurons) {
-            _z += neuron.a * neurons[i].weights[j++];
+bool Layer::sparseActivations() const {
+    // the index gather defeats vectorization, so it only pays off once a good share of the outputs are zero
+    return activationType == RELU && active_set.size() * 4 < neurons.size() * 3;
+}
+
+bool Layer::tracksActivations() const {
+    return track_activations;
+}
+
+void Layer::setTensorParallel(bool enabled) {
+    tensor_parallel = enabled;
+    neuron_blocks.clear();
+}
+
+bool Layer::usesTensorParallel() const {
+    return tensor_parallel;
+}
+
+const std::vector<uint32_t>& Layer::getActiveSet() const {
+    return active_set;
+}
+
+void Layer::forwardBatch(const double* input, size_t input_n, size_t batch, double* output) const {
+    zBatch(input, input_n, batch, output);
+    activateBatch(output, batch);
+}
+
+void Layer::zBatch(const double* input, size_t input_n, size_t batch, double* z) const {
+    size_t n = neurons.size();
+    // neuron-major: each weight row is loaded once and reused by every sample of the batch. blocks of neurons
+    // go to the pool, every z is still computed by one thread
+    parallelBlocks(n, batch * input_n, [&](size_t begin, size_t end) {
+        for (size_t i=begin; i<end; ++i) {
+            if (!denseKernels()) {
+                for (size_t b=0; b<batch; ++b) {
+                    z[b*n + i] = sparse_kernels ? sparseZ(i, input + b*input_n) : packedZ(i, input + b*input_n, input_n);
+                }
+                continue;
+            }
+            const double* w = neurons[i].weights.data();
+            double bias = neurons[i].bias;
+            for (size_t b=0; b<batch; ++b) {
+                const double* x = input + b*input_n;
+                double _z = 0;
+                for (size_t j=0; j<input_n; ++j) {
+                    _z += x[j] * w[j];
+                }
+                z[b*n + i] = _z + bias;
+            }
+        }
+    });
+}
+
+void Layer::activateBatch(double* values, size_t batch) const {
+    size_t n = neurons.size();
+    if (activationType == SOFTMAX) {
+        for (size_t b=0; b<batch; ++b) {
+            double* row = values + b*n;
+            double max_logit = *std::max_element(row, row + n);
+            double sum = 0;
+            for (size_t i=0; i<n; ++i) {
+                row[i] = std::exp(row[i] - max_logit);
+                sum += row[i];
+            }
+            for (size_t i=0; i<n; ++i) row[i] /= sum;
+        }
+        return;
+    }
+    // inline loops for the common cases so they vectorize, instead of a call through activation_fxn per value
+    size_t count = batch*n;
+    switch (activationType) {
+        case LINEAR:
+            return;
+        case RELU:
+            for (size_t k=0; k<count; ++k) values[k] = std::max(0.0, values[k]);
+            return;
+        case SIGMOID:
+            if (activation_accuracy != Polynomial) break;
+            for (size_t k=0; k<count; ++k) values[k] = fastSigmoid(values[k]);
+            return;
+        case TANH:
+            if (activation_accuracy != Polynomial) break;
+            for (size_t k=0; k<count; ++k) values[k] = fastTanh(values[k]);
+            return;
+        default:
+            break;
+    }
+    for (size_t k=0; k<count; ++k) {
+        values[k] = activation_fxn(values[k]);
+    }
+}
+
+void Layer::lastLayerDeltaBatch(const double* output, const double* Y, size_t batch, LossFxn loss_fxn, double* delta) const {
+    for (size_t k=0; k<batch*neurons.size(); ++k) {
+        delta[k] = activationDerivativeFromOutput(activationType, output[k]) * lossFunctionDerivative(loss_fxn, output[k], Y[k]);
+    }
+}
+
+void Layer::weightGradientBatch(const double* delta, const double* input, size_t input_n, size_t batch,
+                                double* weight_gradient, double* bias_gradient) const {
+    size_t n = neurons.size();
+    double scale = 1.0 / static_cast<double>(batch); // averaged over the batch like computeWeightGradient
+    std::fill(weight_gradient, weight_gradient + n*input_n, 0.0);
+    parallelBlocks(n, batch * input_n, [&](size_t begin, size_t end) { // each block owns its gradient rows
+        for (size_t i=begin; i<end; ++i) {
+            double* g = weight_gradient + i*input_n;
+            double bias_sum = 0;
+            for (size_t b=0; b<batch; ++b) {
+                double d = delta[b*n + i];
+                if (d == 0) continue; // common after RELU
+                const double* x = input + b*input_n;
+                for (size_t j=0; j<input_n; ++j) {
+                    g[j] += d * x[j];
+                }
+                bias_sum += d;
+            }
+            for (size_t j=0; j<input_n; ++j) g[j] *= scale;
+            bias_gradient[i] = bias_sum * scale;
+        }
+    });
+}
+
+void Layer::propagateDeltaBatch(const double* delta, size_t batch, double* prev_delta) const {
+    size_t n = neurons.size(), input_n = getInputCount();
+    std::fill(prev_delta, prev_delta + batch*input_n, 0.0);
+    parallelBlocks(batch, n * input_n, [&](size_t begin, size_t end) { // blocks of samples
+        for (size_t b=begin; b<end; ++b) {
+            double* out = prev_delta + b*input_n;
+            for (size_t i=0; i<n; ++i) {
+                double d = delta[b*n + i];
+                if (d == 0) continue;
+                const double* w = neurons[i].weights.data();
+                for (size_t j=0; j<input_n; ++j) {
+                    out[j] += d * w[j];
+                }
+            }
+        }
+    });
+}
+
+void Layer::activationDerivativeBatch(const double* output, size_t batch, double* values) const {
+    for (size_t k=0; k<batch*neurons.size(); ++k) {
+        values[k] *= activationDerivativeFromOutput(activationType, output[k]);
+    }
+}
+
+void Layer::applyGradients(const double* weight_gradient, const double* bias_gradient, const double eta) {
+    if (!checkTrainable("training")) return;
+    size_t input_n = getInputCount();
+    if (sparse_kernels) { // the unpruned weights and their CSR copies in place, the pattern doesn't change
+        for (size_t i=0; i<neurons.size(); ++i) {
+            auto& weights = neurons[i].weights;
+            const double* g = weight_gradient + i*input_n;
+            for (uint32_t k=csr_row_start[i]; k<csr_row_start[i+1]; ++k) {
+                uint32_t j = csr_columns[k];
+                weights[j] -= g[j] * eta;
+                csr_values[k] = weights[j];
+            }
+            neurons[i].bias -= bias_gradient[i] * eta;
+        }
+        return;
+    }
+    if (weight_precision != FullPrecision) { // the 16-bit copy of the weights that moved, in the same pass
+        for (size_t i=0; i<neurons.size(); ++i) {
+            auto& weights = neurons[i].weights;
+            const double* g = weight_gradient + i*input_n;
+            uint16_t* row = packed_weights.data() + i*input_n;
+            for (size_t j=0; j<input_n; ++j) {
+                double step = g[j] * eta;
+                if (step == 0 || (!weight_mask.empty() && !weight_mask[i*input_n + j])) continue; // pruned stay zero
+                weights[j] -= step;
+                row[j] = packWeight(weights[j]);
+            }
+            neurons[i].bias -= bias_gradient[i] * eta;
+        }
+        return;
+    }
+    for (size_t i=0; i<neurons.size(); ++i) {
+        auto& weights = neurons[i].weights;
+        const double* g = weight_gradient + i*input_n;
+        for (size_t j=0; j<input_n; ++j) {
+            weights[j] -= g[j] * eta;
+        }
+        if (!weight_mask.empty()) {
+            for (size_t j=0; j<input_n; ++j) {
+                if (!weight_mask[i*input_n + j]) weights[j] = 0;
+            }
         }
-        _z += neurons[i].bias;
-        z[i] = _z;
+        neurons[i].bias -= bias_gradient[i] * eta;
     }
+}
+
+std::vector<double> Layer::compute_z_vector(const Layer &prev_layer) {
+    std::vector<double> z;
+    compute_z_vector(prev_layer, z);
     return z;
 }
 
-std::vector<double> Layer::getOutputVector() {
-    std::vector<double> output;
-    output.resize(getNeuronCount());
+void Layer::compute_z_vector(const Layer &prev_layer, std::vector<double>& z) {
+    z.resize(neurons.size());
+    const auto& prevlayer_neurons = prev_layer.getNeuronsReadOnly();
+    if (!denseKernels()) {
+        input_buffer.resize(prevlayer_neurons.size());
+        for (size_t j=0; j<prevlayer_neurons.size(); ++j) {
+            input_buffer[j] = prevlayer_neurons[j].a;
+        }
+        compute_z_vector(input_buffer.data(), input_buffer.size(), z);
+        return;
+    }
+
+    forNeuronBlocks([&](size_t begin, size_t end) {
+        for (size_t i=begin; i<end; ++i) {
+            double _z = 0;
+            int j = 0;
+            for (const auto& neuron : prevlayer_neurons) {
+                _z += neuron.a * neurons[i].weights[j++];
+            }
+            _z += neurons[i].bias;
+            z[i] = _z;
+        }
+    });
+}
+
+void Layer::compute_z_vector(const double* input_vec, size_t input_n, std::vector<double>& z) {
+    z.resize(neurons.size());
+    forNeuronBlocks([&](size_t begin, size_t end) {
+        if (sparse_kernels) {
+            for (size_t i=begin; i<end; ++i) {
+                z[i] = sparseZ(i, input_vec);
+            }
+            return;
+        }
+        if (weight_precision != FullPrecision) {
+            for (size_t i=begin; i<end; ++i) {
+                z[i] = packedZ(i, input_vec, input_n);
+            }
+            return;
+        }
+        for (size_t i=begin; i<end; ++i) {
+            double _z = 0;
+            for (size_t j=0; j<input_n; ++j) {
+                _z += input_vec[j] * neurons[i].weights[j];
+            }
+            _z += neurons[i].bias;
+            z[i] = _z;
+        }
+    });
+}
+
+const std::vector<double>& Layer::getOutputVector() {
+    output_buffer.resize(getNeuronCount());
     for (int i=0; i<getNeuronCount(); ++i) {
-        output[i] = neurons[i].a;
+        output_buffer[i] = neurons[i].a;
     }
-    return output;
+    return output_buffer;
 }
 
 void Layer::setActivationFxn(ActivationType) {
@@ -135,13 +538,15 @@ void Layer::setActivationFxn(ActivationType) {
             activation_fxn = &linear;
             break;
         case SIGMOID:
-            activation_fxn = &sigmoid;
+            activation_fxn = activation_accuracy == Polynomial ? &fastSigmoid
+                           : activation_accuracy == LookupTable ? &tableSigmoid : &sigmoid;
             break;
         case RELU:
             activation_fxn = &relu;
             break;
         case TANH:
-            activation_fxn = &std::tanh;
+            activation_fxn = activation_accuracy == Polynomial ? &fastTanh
+                           : activation_accuracy == LookupTable ? &tableTanh : static_cast<double (*)(double)>(&std::tanh);
             break;
         case SOFTMAX:
             activation_fxn = nullptr; // we use different logic for softmax
@@ -150,23 +555,51 @@ void Layer::setActivationFxn(ActivationType) {
     }
 }
 
+void Layer::setActivationAccuracy(ActivationAccuracy accuracy) {
+    activation_accuracy = accuracy;
+    setActivationFxn(activationType);
+}
+
+ActivationAccuracy Layer::getActivationAccuracy() const {
+    return activation_accuracy;
+}
+
 ActivationType Layer::getActivationType() const {
     return activationType;
 }
 
 void Layer::computeDelta(const Layer &next_layer) {
-    double delCdelA = 0, activationDerivative = 0;
     int next_layer_size = next_layer.neurons.size();
 
-    for(int i=0; i<neurons.size(); ++i) {
-        delCdelA = 0;
+    if (next_layer.sparse_kernels) { // scatter each next neuron's delta along its unpruned weights (CSR rows)
+        backward_buffer.assign(neurons.size(), 0.0);
         for (int j=0; j<next_layer_size; ++j) {
-            delCdelA += (next_layer.neurons[j].delta * next_layer.neurons[j].weights[i]);
+            double next_delta = next_layer.neurons[j].delta;
+            for (uint32_t k=next_layer.csr_row_start[j]; k<next_layer.csr_row_start[j+1]; ++k) {
+                backward_buffer[next_layer.csr_columns[k]] += next_delta * next_layer.csr_values[k];
+            }
         }
-        activationDerivative = activationFxnDerivative(activationType, neurons[i].z);
-
-        neurons[i].delta = delCdelA * activationDerivative;
+        for (int i=0; i<neurons.size(); ++i) {
+            neurons[i].delta = backward_buffer[i] * activationDerivativeFromOutput(activationType, neurons[i].a);
+        }
+        return;
     }
+
+    forNeuronBlocks([&](size_t begin, size_t end) {
+        for (size_t i=begin; i<end; ++i) {
+            if (activationType == RELU && neurons[i].z <= 0) { // zero derivative, the dot product can't change that
+                neurons[i].delta = 0;
+                continue;
+            }
+            double delCdelA = 0;
+            for (int j=0; j<next_layer_size; ++j) {
+                delCdelA += (next_layer.neurons[j].delta * next_layer.neurons[j].weights[i]);
+            }
+            double activationDerivative = activationDerivativeFromOutput(activationType, neurons[i].a);
+
+            neurons[i].delta = delCdelA * activationDerivative;
+        }
+    });
 }
 
 void Layer::clearDeltas() {
@@ -176,9 +609,13 @@ void Layer::clearDeltas() {
 }
 
 void Layer::clearWeightGradients() {
+    if (sparse_kernels) {
+        std::fill(csr_gradients.begin(), csr_gradients.end(), 0.0);
+        return;
+    }
     for (auto &neuron : neurons) {
-        neuron.weightGradient.clear();
         neuron.weightGradient.resize(neuron.weights.size());
+        std::fill(neuron.weightGradient.begin(), neuron.weightGradient.end(), 0.0);
     }
 }
 
@@ -189,39 +626,384 @@ void Layer::clearBiasGradients() {
 }
 
 void Layer::computeLastLayerDelta(const std::vector<double> &Y_train, LossFxn loss_fxn) {
+    computeLastLayerDelta(Y_train.data(), loss_fxn);
+}
+
+void Layer::computeLastLayerDelta(const double* Y_train, LossFxn loss_fxn) {
     for (int i=0; i<getNeuronCount(); ++i) {
         neurons[i].delta = 0;
-        neurons[i].delta += activationFxnDerivative(activationType, neurons[i].z);
+        neurons[i].delta += activationDerivativeFromOutput(activationType, neurons[i].a);
         neurons[i].delta *= lossFunctionDerivative(loss_fxn, neurons[i].a, Y_train[i]);
     }
 }
 
 void Layer::computeWeightGradient(const Layer &prev_layer, int sample_size) {
-    for (auto & neuron : neurons) {
-        // weights gradient
-        for (int j=0; j<prev_layer.neurons.size(); ++j) {
-            neuron.weightGradient[j] += (neuron.delta * prev_layer.neurons[j].a) / sample_size;
+    forNeuronBlocks([&](size_t begin, size_t end) {
+        if (sparse_kernels) { // pruned weights keep a zero gradient
+            for (size_t i=begin; i<end; ++i) {
+                auto& neuron = neurons[i];
+                for (uint32_t k=csr_row_start[i]; k<csr_row_start[i+1]; ++k) {
+                    csr_gradients[k] += (neuron.delta * prev_layer.neurons[csr_columns[k]].a) / sample_size;
+                }
+                neuron.biasGradient += neuron.delta / sample_size;
+            }
+            return;
         }
-        // bias gradient
-        neuron.biasGradient += neuron.delta / sample_size;
-    }
+        if (prev_layer.sparseActivations()) { // the gradient of a weight on a zero input is zero
+            for (size_t i=begin; i<end; ++i) {
+                auto& neuron = neurons[i];
+                for (uint32_t j : prev_layer.active_set) {
+                    neuron.weightGradient[j] += (neuron.delta * prev_layer.neurons[j].a) / sample_size;
+                }
+                neuron.biasGradient += neuron.delta / sample_size;
+            }
+            return;
+        }
+        for (size_t i=begin; i<end; ++i) {
+            auto& neuron = neurons[i];
+            // weights gradient
+            for (int j=0; j<prev_layer.neurons.size(); ++j) {
+                neuron.weightGradient[j] += (neuron.delta * prev_layer.neurons[j].a) / sample_size;
+            }
+            // bias gradient
+            neuron.biasGradient += neuron.delta / sample_size;
+        }
+    });
 }
 
 void Layer::computeWeightGradient(const std::vector<double> &prev_layer, int sample_size) {
-    for (auto & neuron : neurons) {
-        // weights gradient
-        for (int j=0; j<prev_layer.size(); ++j) {
-            neuron.weightGradient[j] += (neuron.delta * prev_layer[j]) / sample_size;
+    computeWeightGradient(prev_layer.data(), prev_layer.size(), sample_size);
+}
+
+void Layer::computeWeightGradient(const double* prev_layer, size_t prev_n, int sample_size) {
+    forNeuronBlocks([&](size_t begin, size_t end) {
+        if (sparse_kernels) {
+            for (size_t i=begin; i<end; ++i) {
+                auto& neuron = neurons[i];
+                for (uint32_t k=csr_row_start[i]; k<csr_row_start[i+1]; ++k) {
+                    csr_gradients[k] += (neuron.delta * prev_layer[csr_columns[k]]) / sample_size;
+                }
+                neuron.biasGradient += neuron.delta / sample_size;
+            }
+            return;
         }
-        // bias gradient
-        neuron.biasGradient += neuron.delta / sample_size;
-    }
+        for (size_t i=begin; i<end; ++i) {
+            auto& neuron = neurons[i];
+            // weights gradient
+            for (size_t j=0; j<prev_n; ++j) {
+                neuron.weightGradient[j] += (neuron.delta * prev_layer[j]) / sample_size;
+            }
+            // bias gradient
+            neuron.biasGradient += neuron.delta / sample_size;
+        }
+    });
 }
 
 void Layer::gradientDescent(const double eta) {
+    if (!checkTrainable("training")) return;
+    if (sparse_kernels) { // update the unpruned weights and their CSR copies only
+        for (size_t i=0; i<neurons.size(); ++i) {
+            auto& neuron = neurons[i];
+            for (uint32_t k=csr_row_start[i]; k<csr_row_start[i+1]; ++k) {
+                uint32_t j = csr_columns[k];
+                neuron.weights[j] -= csr_gradients[k] * eta;
+                csr_values[k] = neuron.weights[j];
+            }
+            neuron.bias -= neuron.biasGradient * eta;
+        }
+        return;
+    }
+    if (weight_precision != FullPrecision) { // the 16-bit copy of the weights that moved, in the same pass
+        size_t input_n = getInputCount();
+        for (size_t i=0; i<neurons.size(); ++i) {
+            auto& neuron = neurons[i];
+            uint16_t* row = packed_weights.data() + i*input_n;
+            for (size_t j=0; j<input_n; ++j) {
+                double step = neuron.weightGradient[j] * eta;
+                if (step == 0 || (!weight_mask.empty() && !weight_mask[i*input_n + j])) continue; // pruned stay zero
+                neuron.weights[j] -= step;
+                row[j] = packWeight(neuron.weights[j]);
+            }
+            neuron.bias -= neuron.biasGradient * eta;
+        }
+        return;
+    }
     for (auto& neuron : neurons) {
         neuron.gradientDescent(eta);
     }
+    if (!weight_mask.empty()) {
+        size_t input_n = getInputCount();
+        for (size_t i=0; i<neurons.size(); ++i) {
+            for (size_t j=0; j<input_n; ++j) {
+                if (!weight_mask[i*input_n + j]) neurons[i].weights[j] = 0;
+            }
+        }
+    }
+}
+
+void Layer::setWeightPrecision(WeightPrecision precision, bool keep_master) {
+    if (precision != weight_precision) { // the packed copy is kept up to date, only a switch repacks
+        if (!checkTrainable("changing the weight precision")) return;
+        weight_precision = precision;
+        repackWeights();
+    }
+    if (!keep_master) compactForInference();
+}
+
+WeightPrecision Layer::getWeightPrecision() const {
+    return weight_precision;
+}
+
+void Layer::repackWeights() {
+    if (!checkTrainable("repacking the weights")) return;
+    size_t input_n = getInputCount();
+    if (sparse_kernels) { // the pattern comes from the mask, so a weight that trains through zero keeps its slot
+        csr_values.clear();
+        csr_columns.clear();
+        csr_row_start.assign(1, 0);
+        for (size_t i=0; i<neurons.size(); ++i) {
+            for (size_t j=0; j<input_n; ++j) {
+                bool kept = weight_mask.empty() ? neurons[i].weights[j] != 0 : weight_mask[i*input_n + j] != 0;
+                if (kept) {
+                    csr_values.push_back(neurons[i].weights[j]);
+                    csr_columns.push_back(static_cast<uint32_t>(j));
+                }
+            }
+            csr_row_start.push_back(static_cast<uint32_t>(csr_values.size()));
+        }
+        csr_gradients.assign(csr_values.size(), 0.0); // the dense gradient rows aren't needed any more
+        for (auto& neuron : neurons) {
+            neuron.weightGradient.clear();
+            neuron.weightGradient.shrink_to_fit();
+        }
+    }
+    else {
+        csr_values.clear();
+        csr_columns.clear();
+        csr_row_start.clear();
+        csr_gradients.clear();
+        csr_gradients.shrink_to_fit();
+        for (auto& neuron : neurons) {
+            neuron.weightGradient.resize(neuron.weights.size());
+        }
+    }
+    if (weight_precision == FullPrecision) {
+        packed_weights.clear();
+        packed_weights.shrink_to_fit();
+        return;
+    }
+    packed_weights.resize(neurons.size() * input_n);
+    for (size_t i=0; i<neurons.size(); ++i) {
+        uint16_t* row = packed_weights.data() + i*input_n;
+        for (size_t j=0; j<input_n; ++j) {
+            row[j] = packWeight(neurons[i].weights[j]);
+        }
+    }
+}
+
+uint16_t Layer::packWeight(double w) const {
+    float f = static_cast<float>(w);
+    return weight_precision == BFloat16 ? toBFloat16(f) : toFloat16(f);
+}
+
+void Layer::setWeightMask(std::vector<uint8_t> mask) {
+    if (!checkTrainable("pruning")) return;
+    size_t input_n = getInputCount();
+    if (!mask.empty() && mask.size() != neurons.size() * input_n) {
+        std::cerr << "Error: weight mask size doesn't match the layer's weights" << std::endl;
+        return;
+    }
+    weight_mask = std::move(mask);
+    if (!weight_mask.empty()) {
+        for (size_t i=0; i<neurons.size(); ++i) {
+            for (size_t j=0; j<input_n; ++j) {
+                if (!weight_mask[i*input_n + j]) neurons[i].weights[j] = 0;
+            }
+        }
+    }
+    repackWeights();
+}
+
+const std::vector<uint8_t>& Layer::getWeightMask() const {
+    return weight_mask;
+}
+
+double Layer::sparsity() const {
+    if (inference_only) { // from the kernels' copy, the double weights are gone
+        double total = static_cast<double>(neurons.size() * input_count);
+        double nonzeros = sparse_kernels ? std::count_if(csr_values.begin(), csr_values.end(), [](double w) { return w != 0; })
+                        : std::count_if(packed_weights.begin(), packed_weights.end(), [](uint16_t w) { return (w & 0x7fff) != 0; });
+        return total > 0 ? 1 - nonzeros / total : 0;
+    }
+    size_t zeros = 0, total = 0;
+    for (const auto& neuron : neurons) {
+        zeros += std::count(neuron.weights.begin(), neuron.weights.end(), 0.0);
+        total += neuron.weights.size();
+    }
+    return total ? static_cast<double>(zeros) / total : 0;
+}
+
+void Layer::setSparseKernels(bool enabled) {
+    if (!checkTrainable("switching the kernels")) return;
+    sparse_kernels = enabled;
+    repackWeights();
+}
+
+bool Layer::usesSparseKernels() const {
+    return sparse_kernels;
+}
+
+bool Layer::compactForInference() {
+    if (inference_only) return true;
+    if (denseKernels()) return false;
+    input_count = getInputCount();
+    for (auto& neuron : neurons) {
+        neuron.weights.clear();
+        neuron.weights.shrink_to_fit();
+        neuron.weightGradient.clear();
+        neuron.weightGradient.shrink_to_fit();
+    }
+    weight_mask.clear();
+    weight_mask.shrink_to_fit();
+    csr_gradients.clear();
+    csr_gradients.shrink_to_fit();
+    if (sparse_kernels) { // the CSR kernels take precedence, the 16-bit copy is never read
+        packed_weights.clear();
+        packed_weights.shrink_to_fit();
+    }
+    inference_only = true;
+    return true;
+}
+
+bool Layer::isInferenceOnly() const {
+    return inference_only;
+}
+
+bool Layer::checkTrainable(const char* what) const {
+    if (!inference_only) return true;
+    std::cerr << "Error: " << what << " needs the double weights, the layer was compacted for inference" << std::endl;
+    return false;
+}
+
+void Layer::appendGradients(std::vector<double>& values, double scale) const {
+    for (double gradient : csr_gradients) values.push_back(gradient * scale); // empty without sparse kernels
+    for (const auto& neuron : neurons) {
+        for (double gradient : neuron.weightGradient) values.push_back(gradient * scale); // freed with them
+        values.push_back(neuron.biasGradient * scale);
+    }
+}
+
+const double* Layer::setGradients(const double* values) {
+    for (double& gradient : csr_gradients) gradient = *values++;
+    for (auto& neuron : neurons) {
+        for (double& gradient : neuron.weightGradient) gradient = *values++;
+        neuron.biasGradient = *values++;
+    }
+    return values;
+}
+
+void Layer::setActivationTracking(bool enabled) {
+    track_activations = enabled;
+    resetActivationStats();
+}
+
+void Layer::resetActivationStats() {
+    activation_counts.assign(neurons.size(), 0);
+    tracked_samples = 0;
+}
+
+std::vector<NeuronStats> Layer::getNeuronStats() const {
+    std::vector<NeuronStats> stats(neurons.size());
+    size_t input_n = getInputCount();
+    for (size_t i=0; i<neurons.size(); ++i) {
+        double squares = 0;
+        if (!inference_only) {
+            for (double w : neurons[i].weights) squares += w*w;
+        } else if (sparse_kernels) { // the double weights are gone, read what the forward pass reads
+            for (uint32_t k=csr_row_start[i]; k<csr_row_start[i+1]; ++k) squares += csr_values[k]*csr_values[k];
+        } else {
+            for (size_t j=0; j<input_n; ++j) {
+                uint16_t w = packed_weights[i*input_n + j];
+                double value = weight_precision == BFloat16 ? fromBFloat16(w) : fromFloat16(w);
+                squares += value*value;
+            }
+        }
+        stats[i].weight_norm = std::sqrt(squares);
+        stats[i].active_fraction = activationType != RELU ? 1.0
+            : tracked_samples ? static_cast<double>(activation_counts[i]) / tracked_samples : 1.0; // unknown counts as alive
+    }
+    return stats;
+}
+
+void Layer::removeNeurons(const std::vector<size_t>& indices) {
+    if (indices.empty() || !checkTrainable("removing neurons")) return;
+    size_t input_n = getInputCount();
+    std::vector<uint8_t> removed(neurons.size(), 0);
+    for (size_t i : indices) removed[i] = 1;
+
+    size_t kept = 0;
+    for (size_t i=0; i<neurons.size(); ++i) {
+        if (removed[i]) continue;
+        if (kept != i) {
+            neurons[kept] = std::move(neurons[i]);
+            if (!weight_mask.empty()) {
+                std::copy_n(weight_mask.begin() + i*input_n, input_n, weight_mask.begin() + kept*input_n);
+            }
+            if (track_activations) activation_counts[kept] = activation_counts[i];
+        }
+        ++kept;
+    }
+    neurons.resize(kept);
+    if (!weight_mask.empty()) weight_mask.resize(kept * input_n);
+    if (track_activations) activation_counts.resize(kept);
+    bool tracking = track_activations;
+    track_activations = false; // recomputing the moved indices isn't a tracked sample
+    updateActiveSet();
+    track_activations = tracking;
+    repackWeights();
+}
+
+void Layer::removeInputs(const std::vector<size_t>& indices) {
+    if (indices.empty() || !checkTrainable("removing inputs")) return;
+    size_t input_n = getInputCount();
+    std::vector<uint8_t> removed(input_n, 0);
+    for (size_t j : indices) removed[j] = 1;
+
+    auto compact = [&removed](auto& row) {
+        size_t kept = 0;
+        for (size_t j=0; j<row.size(); ++j) {
+            if (!removed[j]) row[kept++] = row[j];
+        }
+        row.resize(kept);
+    };
+    std::vector<uint8_t> mask_row;
+    std::vector<uint8_t> mask;
+    for (size_t i=0; i<neurons.size(); ++i) {
+        compact(neurons[i].weights);
+        compact(neurons[i].weightGradient);
+        if (!weight_mask.empty()) {
+            mask_row.assign(weight_mask.begin() + i*input_n, weight_mask.begin() + (i+1)*input_n);
+            compact(mask_row);
+            mask.insert(mask.end(), mask_row.begin(), mask_row.end());
+        }
+    }
+    weight_mask = std::move(mask);
+    repackWeights();
+}
+
+double Layer::sparseZ(size_t i, const double* input_vec) const {
+    double _z = 0;
+    for (uint32_t k=csr_row_start[i]; k<csr_row_start[i+1]; ++k) {
+        _z += csr_values[k] * input_vec[csr_columns[k]];
+    }
+    return _z + neurons[i].bias;
+}
+
+double Layer::packedZ(size_t i, const double* input_vec, size_t input_n) const {
+    const uint16_t* row = packed_weights.data() + i*input_n;
+    float acc = weight_precision == BFloat16 ? dotPacked<fromBFloat16>(row, input_vec, input_n)
+                                             : dotPacked<fromFloat16>(row, input_vec, input_n);
+    return acc + neurons[i].bias;
 }
 
 void Layer::printWeights() {
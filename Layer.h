@@ -5,6 +5,7 @@
 #ifndef LAYER_H
 #define LAYER_H
 
+#include <cstdint>
 #include <vector>
 #include <random>
 #include <functional>
@@ -15,10 +16,52 @@
 
 class Neuron;
 
+struct NeuronStats {
+    double active_fraction; // share of the tracked forward passes with output > 0 (RELU layers, 1 otherwise)
+    double weight_norm; // L2 norm of the incoming weights
+};
+
 class Layer {
     std::vector<Neuron> neurons;
     ActivationType activationType;
     double (*activation_fxn)(double); // for softmax processing, we use different logic
+    ActivationAccuracy activation_accuracy = Exact;
+    std::vector<double> z_buffer; // reused by softmax and getOutputVector so the steady state doesn't allocate
+    std::vector<double> output_buffer;
+    WeightPrecision weight_precision = FullPrecision;
+    std::vector<uint16_t> packed_weights; // neuron count x input count, row-major, used by the forward pass when not FullPrecision
+    std::vector<double> input_buffer; // previous layer's activations gathered contiguously for the packed/sparse kernels
+    std::vector<uint8_t> weight_mask; // neuron count x input count, 0 = pruned. empty when nothing is pruned
+    bool sparse_kernels = false;
+    std::vector<double> csr_values; // unpruned weights in CSR, kept in sync with the double weights
+    std::vector<uint32_t> csr_columns;
+    std::vector<uint32_t> csr_row_start; // neuron count + 1 offsets into csr_values
+    std::vector<double> csr_gradients; // with sparse kernels the weight gradients live here, the neurons' rows are freed
+    bool inference_only = false; // compactForInference dropped the double weights
+    unsigned long input_count = 0; // kept for getInputCount once the weights are gone
+    std::vector<double> backward_buffer; // dC/da of this layer, scattered from a sparse next layer
+    std::vector<uint32_t> active_set; // RELU layers: indices of the neurons whose last output was > 0
+    bool track_activations = false;
+    std::vector<unsigned long> activation_counts; // per neuron, forward passes with output > 0 since the last reset
+    unsigned long tracked_samples = 0;
+    bool tensor_parallel = false;
+    std::vector<size_t> neuron_blocks; // block boundaries over the neurons, cached for the shape below
+    unsigned long blocks_input_n = 0;
+
+    bool denseKernels() const { return weight_precision == FullPrecision && !sparse_kernels; }
+    double packedZ(size_t i, const double* input_vec, size_t input_n) const; // float accumulation over 16-bit weights
+    uint16_t packWeight(double w) const;
+    double sparseZ(size_t i, const double* input_vec) const;
+    void activateZBuffer(); // z_buffer -> neurons' z and a
+    void zBatch(const double* input, size_t input_n, size_t batch, double* z) const;
+    void activateBatch(double* values, size_t batch) const; // in place, row-wise softmax
+    void updateActiveSet();
+    bool sparseActivations() const; // worth skipping this layer's zero outputs in the next layer
+    // body(begin, end) over neuron blocks, on the global ThreadPool when tensor parallel, else called directly once
+    // over all of them. a template, so the unsplit path doesn't wrap the lambda in a std::function (an allocation)
+    template <typename Body>
+    void forNeuronBlocks(const Body& body);
+    bool checkTrainable(const char* what) const; // false with an error after compactForInference
 
 public:
     Layer(unsigned int prev_n, unsigned int cur_n, ActivationType _activationType = RELU);
@@ -32,19 +75,77 @@ public:
     void set_z(const std::vector<double>&& new_zs);
     void set_a(const std::vector<double>&& new_as);
     unsigned long getNeuronCount() const;
-    void forward(const Layer& prev_layer);
+    unsigned long getInputCount() const;
+    double flopCount(TrainingPhase, unsigned long next_n) const; // per sample, next_n = 0 for the last layer
+    double byteCount(TrainingPhase, unsigned long next_n) const; // weight/activation traffic per sample
+    void forward(const Layer& prev_layer); // after a RELU layer, only the previous layer's active set is read
+    void forward(const double* input_vec, size_t input_n); // first layer, reads the input directly instead of an input Layer
+    // inference over a batch without touching the neurons' z/a (so it's const and thread safe).
+    // input is batch x input_n, output batch x neuron count, both row-major
+    void forwardBatch(const double* input, size_t input_n, size_t batch, double* output) const;
+    // batched backward over caller-owned buffers (BatchedTrainer), all batch x width row-major like forwardBatch.
+    // derivatives come from the outputs, so z isn't kept. gradients are averaged over the batch;
+    // weight_gradient is neuron count x input count
+    void lastLayerDeltaBatch(const double* output, const double* Y, size_t batch, LossFxn, double* delta) const;
+    void weightGradientBatch(const double* delta, const double* input, size_t input_n, size_t batch,
+                             double* weight_gradient, double* bias_gradient) const;
+    void propagateDeltaBatch(const double* delta, size_t batch, double* prev_delta) const; // dC/da of the previous layer
+    void activationDerivativeBatch(const double* output, size_t batch, double* values) const; // values *= f'(z)
+    void applyGradients(const double* weight_gradient, const double* bias_gradient, const double eta);
     std::vector<double> compute_z_vector(const Layer &prev_layer);
-    std::vector<double> getOutputVector();
+    void compute_z_vector(const Layer &prev_layer, std::vector<double>& z);
+    void compute_z_vector(const double* input_vec, size_t input_n, std::vector<double>& z);
+    const std::vector<double>& getOutputVector();
+    const std::vector<uint32_t>& getActiveSet() const; // RELU only, as of the last forward
     void setActivationFxn(ActivationType);
+    void setActivationAccuracy(ActivationAccuracy);
+    ActivationAccuracy getActivationAccuracy() const;
     ActivationType getActivationType() const;
     void computeDelta(const Layer &next_layer);
     void clearDeltas();
     void clearWeightGradients();
     void clearBiasGradients();
     void computeLastLayerDelta(const std::vector<double>& Y_train, LossFxn);
+    void computeLastLayerDelta(const double* Y_train, LossFxn);
     void computeWeightGradient(const Layer& prev_layer, int sample_size);
     void computeWeightGradient(const std::vector<double>& prev_layer, int sample_size);
+    void computeWeightGradient(const double* prev_layer, size_t prev_n, int sample_size);
     void gradientDescent(const double eta);
+    // 16-bit weights halve the forward pass's weight traffic. training still updates the double weights and rewrites
+    // the 16-bit copy of each weight it moves; call repackWeights after editing weights through getNeurons().
+    // keep_master = false drops the double weights once packed (compactForInference), for inference only
+    void setWeightPrecision(WeightPrecision, bool keep_master = true);
+    WeightPrecision getWeightPrecision() const;
+    void repackWeights();
+    // pruning: masked weights are zeroed and stay zero through training. with sparse kernels on, forward, deltas,
+    // gradients and the update only visit the unpruned weights (CSR), and take precedence over 16-bit weights.
+    // the weight gradients are then only kept in CSR
+    void setWeightMask(std::vector<uint8_t> mask); // neuron count x input count, 0 = pruned
+    const std::vector<uint8_t>& getWeightMask() const;
+    double sparsity() const; // fraction of weights that are zero
+    void setSparseKernels(bool);
+    bool usesSparseKernels() const;
+    // for layers on sparse or 16-bit kernels: frees the double weights, their gradients and the mask, which the
+    // forward pass doesn't read. inference only from then on, training and editing the weights are refused.
+    // returns false (and keeps everything) for a layer on the dense kernels, which need the double weights
+    bool compactForInference();
+    bool isInferenceOnly() const;
+    // weight gradients (only the unpruned ones with sparse kernels) then bias gradients, for exchanging them
+    void appendGradients(std::vector<double>& values, double scale) const;
+    const double* setGradients(const double* values); // the reverse, returns the end of what it read
+    // structured pruning: counts how often each RELU neuron fires, and shrinks the layer (removeNeurons) or the
+    // weight columns reading a removed neuron of the previous layer (removeInputs). indices sorted and unique
+    void setActivationTracking(bool);
+    bool tracksActivations() const;
+    void resetActivationStats();
+    std::vector<NeuronStats> getNeuronStats() const;
+    void removeNeurons(const std::vector<size_t>& indices);
+    void removeInputs(const std::vector<size_t>& indices);
+    // tensor parallelism for very wide layers: the single-sample forward (compute_z_vector), computeDelta and
+    // computeWeightGradient split the neurons into blocks whose weight rows fit in L2 and run them on the
+    // global ThreadPool. results are the same as serial, each neuron is still computed by one thread
+    void setTensorParallel(bool);
+    bool usesTensorParallel() const;
 
     void printWeights(); // just for testing
     void printOutput(); // just for testing
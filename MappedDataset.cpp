@@ -0,0 +1,191 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#include "MappedDataset.h"
+#include "StreamingDataset.h"
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(sizeof(DatasetHeader) == 64, "the .nnds header is 64 bytes on disk");
+
+namespace {
+    const uint32_t format_version = 1;
+
+    uint64_t alignUp(uint64_t offset) {
+        return (offset + 63) / 64 * 64;
+    }
+
+    size_t elementSize(DatasetDType dtype) {
+        return dtype == Float32 ? sizeof(float) : sizeof(double);
+    }
+
+    // rows x count elements at offset lie past the header and inside the file, computed without overflowing
+    bool blockFits(uint64_t offset, uint64_t rows, uint64_t count, size_t elem, size_t file_size) {
+        if (offset < sizeof(DatasetHeader) || offset > file_size || offset % 64 != 0) return false;
+        if (count != 0 && rows > UINT64_MAX / count) return false;
+        uint64_t elements = rows * count;
+        return elements <= (file_size - offset) / elem;
+    }
+}
+
+MappedDataset::MappedDataset(const std::string& path)
+    : mapping(nullptr), mapping_size(0), header()
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Cannot open dataset: " << path << std::endl;
+        return;
+    }
+    struct stat st{};
+    fstat(fd, &st);
+    if (st.st_size < static_cast<off_t>(sizeof(DatasetHeader))) {
+        std::cerr << "Not a .nnds dataset (too small): " << path << std::endl;
+        close(fd);
+        return;
+    }
+    void* ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file alive
+    if (ptr == MAP_FAILED) {
+        std::cerr << "Cannot mmap dataset: " << path << std::endl;
+        return;
+    }
+    mapping = static_cast<const unsigned char*>(ptr);
+    mapping_size = st.st_size;
+    std::memcpy(&header, mapping, sizeof(DatasetHeader));
+
+    // the counts and offsets come from the file: check them before they become pointers
+    size_t elem = elementSize(header.dtype);
+    bool valid = std::memcmp(header.magic, "NNDS", 4) == 0 && header.version == format_version
+                 && (header.dtype == Float64 || header.dtype == Float32) && (header.layout == RowMajor || header.layout == Columnar)
+                 && blockFits(header.features_offset, header.rows, header.feature_count, elem, mapping_size)
+                 && blockFits(header.labels_offset, header.rows, header.label_count, elem, mapping_size);
+    if (!valid) {
+        std::cerr << "Corrupt or unsupported .nnds header: " << path << std::endl;
+        munmap(const_cast<unsigned char*>(mapping), mapping_size);
+        mapping = nullptr;
+        mapping_size = 0;
+        header = DatasetHeader();
+        return;
+    }
+    madvise(const_cast<unsigned char*>(mapping), mapping_size, header.layout == RowMajor ? MADV_SEQUENTIAL : MADV_NORMAL);
+}
+
+MappedDataset::~MappedDataset() {
+    if (mapping) munmap(const_cast<unsigned char*>(mapping), mapping_size);
+}
+
+bool MappedDataset::isOpen() const {
+    return mapping != nullptr;
+}
+
+size_t MappedDataset::getRowCount() const {
+    return header.rows;
+}
+
+size_t MappedDataset::getFeatureCount() const {
+    return header.feature_count;
+}
+
+size_t MappedDataset::getLabelCount() const {
+    return header.label_count;
+}
+
+DatasetDType MappedDataset::getDType() const {
+    return header.dtype;
+}
+
+DatasetLayout MappedDataset::getLayout() const {
+    return header.layout;
+}
+
+const double* MappedDataset::features(size_t i, std::vector<double>& scratch) const {
+    return row(header.features_offset, header.feature_count, i, scratch);
+}
+
+const double* MappedDataset::labels(size_t i, std::vector<double>& scratch) const {
+    return row(header.labels_offset, header.label_count, i, scratch);
+}
+
+const double* MappedDataset::row(uint64_t offset, size_t count, size_t i, std::vector<double>& scratch) const {
+    const unsigned char* block = mapping + offset;
+    if (header.layout == RowMajor && header.dtype == Float64) {
+        return reinterpret_cast<const double*>(block) + i * count;
+    }
+    scratch.resize(count);
+    for (size_t k=0; k<count; ++k) {
+        size_t index = header.layout == RowMajor ? i * count + k : k * header.rows + i;
+        scratch[k] = header.dtype == Float64 ? reinterpret_cast<const double*>(block)[index]
+                                             : static_cast<double>(reinterpret_cast<const float*>(block)[index]);
+    }
+    return scratch.data();
+}
+
+bool MappedDataset::convertFromCsv(const std::string& csv_path, const std::string& out_path, size_t feature_count, size_t label_count,
+                                   bool has_header, DatasetLayout layout, DatasetDType dtype) {
+    // pass 1: count the rows, so both blocks can be placed before anything is written
+    StreamingDataset csv(csv_path, CSV, feature_count, label_count, 4096, has_header);
+    uint64_t rows = 0;
+    while (const DataChunk* chunk = csv.nextChunk()) {
+        rows += chunk->rows;
+    }
+    if (!csv.isOpen() || rows == 0) {
+        std::cerr << "Nothing to convert in " << csv_path << std::endl;
+        return false;
+    }
+
+    size_t elem = elementSize(dtype);
+    DatasetHeader header{};
+    std::memcpy(header.magic, "NNDS", 4);
+    header.version = format_version;
+    header.rows = rows;
+    header.feature_count = feature_count;
+    header.label_count = label_count;
+    header.dtype = dtype;
+    header.layout = layout;
+    header.features_offset = alignUp(sizeof(DatasetHeader));
+    header.labels_offset = alignUp(header.features_offset + rows * feature_count * elem);
+    uint64_t file_size = header.labels_offset + rows * label_count * elem;
+
+    int fd = open(out_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(file_size)) != 0) {
+        std::cerr << "Cannot create dataset: " << out_path << std::endl;
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    void* ptr = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        std::cerr << "Cannot mmap dataset for writing: " << out_path << std::endl;
+        return false;
+    }
+    auto* out = static_cast<unsigned char*>(ptr);
+    std::memcpy(out, &header, sizeof(DatasetHeader));
+
+    auto store = [&](uint64_t offset, size_t count, size_t i, size_t k, double value) {
+        size_t index = layout == RowMajor ? i * count + k : k * rows + i;
+        if (dtype == Float64)
+            reinterpret_cast<double*>(out + offset)[index] = value;
+        else
+            reinterpret_cast<float*>(out + offset)[index] = static_cast<float>(value);
+    };
+
+    // pass 2: decode again and scatter into the blocks
+    csv.rewind();
+    size_t i = 0;
+    while (const DataChunk* chunk = csv.nextChunk()) {
+        for (size_t r=0; r<chunk->rows && i<rows; ++r, ++i) {
+            for (size_t k=0; k<feature_count; ++k)
+                store(header.features_offset, feature_count, i, k, chunk->features[r * feature_count + k]);
+            for (size_t k=0; k<label_count; ++k)
+                store(header.labels_offset, label_count, i, k, chunk->labels[r * label_count + k]);
+        }
+    }
+    msync(out, file_size, MS_SYNC);
+    munmap(out, file_size);
+    return true;
+}
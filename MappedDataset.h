@@ -0,0 +1,67 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef MAPPEDDATASET_H
+#define MAPPEDDATASET_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum DatasetDType : uint32_t {
+    Float64,
+    Float32,
+};
+
+enum DatasetLayout : uint32_t {
+    RowMajor, // sample i's features are contiguous: fit/predict read them straight out of the mapping
+    Columnar, // feature j of every sample is contiguous
+};
+
+// on-disk header of a .nnds file, followed by the feature block and then the label block, each 64-byte aligned
+struct DatasetHeader {
+    char magic[4]; // "NNDS"
+    uint32_t version;
+    uint64_t rows;
+    uint64_t feature_count;
+    uint64_t label_count;
+    DatasetDType dtype;
+    DatasetLayout layout;
+    uint64_t features_offset; // byte offsets from the start of the file
+    uint64_t labels_offset;
+    uint64_t reserved;
+};
+
+// Read-only mmap of a .nnds file. Nothing is parsed or copied when opening, pages are loaded as training touches them.
+// Opening only checks the header: both blocks have to be 64-byte aligned and inside the file.
+class MappedDataset {
+    const unsigned char* mapping;
+    size_t mapping_size;
+    DatasetHeader header;
+
+    const double* row(uint64_t offset, size_t count, size_t i, std::vector<double>& scratch) const;
+
+public:
+    explicit MappedDataset(const std::string& path);
+    ~MappedDataset();
+    MappedDataset(const MappedDataset&) = delete;
+    MappedDataset& operator=(const MappedDataset&) = delete;
+
+    bool isOpen() const;
+    size_t getRowCount() const;
+    size_t getFeatureCount() const;
+    size_t getLabelCount() const;
+    DatasetDType getDType() const;
+    DatasetLayout getLayout() const;
+
+    // pointer to sample i's values. zero-copy for RowMajor Float64, otherwise gathered/converted into scratch
+    const double* features(size_t i, std::vector<double>& scratch) const;
+    const double* labels(size_t i, std::vector<double>& scratch) const;
+
+    // CSV (features then labels per line) -> .nnds, read in chunks so the CSV never has to fit in memory
+    static bool convertFromCsv(const std::string& csv_path, const std::string& out_path, size_t feature_count, size_t label_count,
+                               bool has_header = false, DatasetLayout layout = RowMajor, DatasetDType dtype = Float64);
+};
+
+#endif //MAPPEDDATASET_H
@@ -0,0 +1,69 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#include "MemoryPlanner.h"
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+
+namespace {
+    size_t alignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+void MemoryPlan::print(std::ostream& out) const {
+    out << std::left << std::setw(14) << "buffer" << std::right << std::setw(12) << "bytes" << std::setw(12) << "offset"
+        << std::setw(10) << "steps" << std::endl;
+    for (const auto& buffer : buffers) {
+        out << std::left << std::setw(14) << buffer.name << std::right << std::setw(12) << buffer.bytes
+            << std::setw(12) << buffer.offset << std::setw(5) << buffer.first_use << "-" << std::left
+            << std::setw(4) << buffer.last_use << std::right << std::endl;
+    }
+    out << "Peak: " << peak_bytes << " bytes in one arena, " << total_bytes << " bytes without reuse" << std::endl;
+}
+
+size_t MemoryPlanner::addBuffer(const std::string& name, size_t bytes, int first_use, int last_use) {
+    buffers.push_back({name, bytes, first_use, last_use, 0});
+    return buffers.size() - 1;
+}
+
+MemoryPlan MemoryPlanner::plan() const {
+    MemoryPlan result{buffers, 0, 0};
+    std::vector<size_t> order(buffers.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return buffers[a].bytes > buffers[b].bytes;
+    });
+
+    std::vector<size_t> placed;
+    std::vector<std::pair<size_t, size_t>> taken; // [offset, end) of placed buffers alive at the same time
+    for (size_t id : order) {
+        auto& buffer = result.buffers[id];
+        taken.clear();
+        for (size_t other : placed) {
+            const auto& o = result.buffers[other];
+            if (o.first_use <= buffer.last_use && buffer.first_use <= o.last_use) {
+                taken.emplace_back(o.offset, o.offset + o.bytes);
+            }
+        }
+        std::sort(taken.begin(), taken.end());
+        size_t offset = 0;
+        for (const auto& range : taken) {
+            if (range.first >= offset + buffer.bytes) break; // fits in the gap before this range
+            offset = std::max(offset, alignUp(range.second, alignment));
+        }
+        buffer.offset = offset;
+        placed.push_back(id);
+        result.peak_bytes = std::max(result.peak_bytes, alignUp(offset + buffer.bytes, alignment));
+        result.total_bytes += alignUp(buffer.bytes, alignment);
+    }
+    return result;
+}
+
+Arena::Arena(const MemoryPlan& plan, size_t alignment)
+    : storage(plan.peak_bytes + alignment) {
+    size_t misalignment = reinterpret_cast<size_t>(storage.data()) % alignment;
+    base = storage.data() + (misalignment ? alignment - misalignment : 0);
+}
@@ -0,0 +1,62 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef MEMORYPLANNER_H
+#define MEMORYPLANNER_H
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// A buffer used from step first_use to step last_use (inclusive) of a fixed schedule.
+struct PlannedBuffer {
+    std::string name;
+    size_t bytes;
+    int first_use;
+    int last_use;
+    size_t offset; // into the arena, assigned by MemoryPlanner::plan
+};
+
+struct MemoryPlan {
+    std::vector<PlannedBuffer> buffers; // in the order they were added, so the ids returned by addBuffer index them
+    size_t peak_bytes; // arena size
+    size_t total_bytes; // what separate allocations of every buffer would take
+
+    void print(std::ostream& = std::cout) const;
+};
+
+// Static memory planning: every buffer's lifetime is known up front, so buffers that are never alive at the same
+// step can share memory. Offsets are assigned greedily, largest buffer first, each at the lowest aligned offset
+// that doesn't overlap a placed buffer with an overlapping lifetime.
+class MemoryPlanner {
+    std::vector<PlannedBuffer> buffers;
+    size_t alignment;
+
+public:
+    explicit MemoryPlanner(size_t _alignment = 64) : alignment(_alignment) {}
+
+    size_t addBuffer(const std::string& name, size_t bytes, int first_use, int last_use); // returns the buffer id
+    MemoryPlan plan() const;
+};
+
+// One aligned block holding every buffer of a MemoryPlan. allocated once, so a step never touches the heap.
+class Arena {
+    std::vector<unsigned char> storage;
+    unsigned char* base;
+
+public:
+    Arena() : base(nullptr) {}
+    explicit Arena(const MemoryPlan&, size_t alignment = 64);
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    Arena(Arena&&) = default;
+    Arena& operator=(Arena&&) = default;
+
+    double* doubles(const MemoryPlan& plan, size_t id) const {
+        return reinterpret_cast<double*>(base + plan.buffers[id].offset);
+    }
+};
+
+#endif //MEMORYPLANNER_H
@@ -0,0 +1,69 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#include "ModelHandle.h"
+#include "NeuralNetwork.h"
+#include <thread>
+
+ModelHandle::ModelHandle(std::unique_ptr<NeuralNetwork> model)
+    : current(model.release()), epoch(0), readers{{0}, {0}} {
+}
+
+ModelHandle::~ModelHandle() {
+    delete current.load(); // no reader may outlive the handle
+}
+
+ModelHandle::ReadGuard::ReadGuard(ModelHandle& _handle)
+    : handle(&_handle), parity(_handle.epoch.load()), model(nullptr) {
+    // count ourselves before loading the pointer: a swap that doesn't see this count yet has already published
+    // the new model, so we can only load the new one
+    handle->readers[parity].fetch_add(1);
+    model = handle->current.load();
+}
+
+ModelHandle::ReadGuard::~ReadGuard() {
+    handle->readers[parity].fetch_sub(1);
+}
+
+ModelHandle::ReadGuard ModelHandle::acquire() {
+    return ReadGuard(*this);
+}
+
+std::vector<double> ModelHandle::predict(const std::vector<double>& input_vector) {
+    ReadGuard model(*this);
+    if (input_vector.size() != model->getInputSize()) {
+        std::cerr << "Error: input vector size doesn't match with the served model's input size" << std::endl;
+        return {};
+    }
+    return model->predictBatch(input_vector.data(), 1);
+}
+
+void ModelHandle::waitForReaders(int parity) const {
+    while (readers[parity].load() != 0) {
+        std::this_thread::yield();
+    }
+}
+
+void ModelHandle::swap(std::unique_ptr<NeuralNetwork> next) {
+    std::lock_guard<std::mutex> lock(writer_mtx);
+    const NeuralNetwork* old = current.exchange(next.release());
+
+    // grace period: flip new readers to the other counter, drain the old one, then the same the other way around.
+    // a reader holding `old` counted itself before the exchange, so it's in one of the two drained counters.
+    // flipping first means new readers never keep the counter being drained from reaching zero.
+    int parity = epoch.load();
+    epoch.store(1 - parity);
+    waitForReaders(parity);
+    epoch.store(parity);
+    waitForReaders(1 - parity);
+
+    delete old;
+}
+
+bool ModelHandle::loadAndSwap(const std::string& model_path) {
+    auto next = std::make_unique<NeuralNetwork>();
+    if (!next->loadModel(model_path)) return false; // keep serving the current model
+    swap(std::move(next));
+    return true;
+}
@@ -0,0 +1,55 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef MODELHANDLE_H
+#define MODELHANDLE_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class NeuralNetwork;
+
+// The model a serving process currently answers with, replaceable while requests are running (RCU style).
+// Readers never lock: they bump a reader counter and load the model pointer. swap() publishes the new model,
+// then waits for a grace period (every reader that could have seen the old model released it) before deleting it.
+class ModelHandle {
+    std::atomic<const NeuralNetwork*> current;
+    std::atomic<int> epoch; // which reader counter new readers use
+    std::atomic<unsigned long> readers[2];
+    std::mutex writer_mtx; // swaps are serialized, reads are not affected
+
+    void waitForReaders(int parity) const;
+
+public:
+    explicit ModelHandle(std::unique_ptr<NeuralNetwork> model);
+    ~ModelHandle();
+    ModelHandle(const ModelHandle&) = delete;
+    ModelHandle& operator=(const ModelHandle&) = delete;
+
+    // keeps the model it was given alive until destroyed, even if a swap happens meanwhile
+    class ReadGuard {
+        ModelHandle* handle;
+        int parity;
+        const NeuralNetwork* model;
+    public:
+        explicit ReadGuard(ModelHandle& handle);
+        ~ReadGuard();
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+        const NeuralNetwork& operator*() const { return *model; }
+        const NeuralNetwork* operator->() const { return model; }
+    };
+
+    ReadGuard acquire();
+    std::vector<double> predict(const std::vector<double>& input_vector); // one sample through predictBatch
+
+    // blocks the caller (not the readers) until no in-flight call uses the old model, then frees it
+    void swap(std::unique_ptr<NeuralNetwork> next);
+    bool loadAndSwap(const std::string& model_path); // NeuralNetwork::loadModel, then swap
+};
+
+#endif //MODELHANDLE_H
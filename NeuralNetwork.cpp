@@ -2,13 +2,46 @@
 // Created by Gun woo Kim on 8/21/24.
 //
 #include "NeuralNetwork.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
 #include <thread>
-#include <unordered_set>
+#include <numeric>
+
+namespace {
+    // row access for the templated training / cost loops
+    struct VectorSamples {
+        const std::vector<std::vector<double>> &X;
+        const std::vector<std::vector<double>> &Y;
+        const double* x(size_t i) const { return X[i].data(); }
+        const double* y(size_t i) const { return Y[i].data(); }
+        const double* x(size_t i, std::vector<double>&) const { return X[i].data(); }
+        const double* y(size_t i, std::vector<double>&) const { return Y[i].data(); }
+    };
+
+    struct MappedSamples {
+        const MappedDataset &dataset;
+        std::vector<double> x_scratch, y_scratch; // only used for columnar / float32 files
+        const double* x(size_t i) { return dataset.features(i, x_scratch); }
+        const double* y(size_t i) { return dataset.labels(i, y_scratch); }
+        // with the caller's scratch, for threads sharing one Samples
+        const double* x(size_t i, std::vector<double>& scratch) const { return dataset.features(i, scratch); }
+        const double* y(size_t i, std::vector<double>& scratch) const { return dataset.labels(i, scratch); }
+    };
+
+    const size_t cost_chunk_rows = 256; // rows per predict of the cost pass
+}
 
 const std::vector<Layer> & NeuralNetwork::getLayerReadOnly() const {
     return layers;
 }
 
+std::vector<Layer>& NeuralNetwork::getLayers() {
+    return layers;
+}
+
 unsigned long NeuralNetwork::getMaxNeuronInLayer() const {
     unsigned long maxNeurons = 0;
     for (int i=0; i<layers.size(); ++i) {
@@ -17,6 +50,10 @@ unsigned long NeuralNetwork::getMaxNeuronInLayer() const {
     return maxNeurons;
 }
 
+unsigned int NeuralNetwork::getInputSize() const {
+    return input_size;
+}
+
 void NeuralNetwork::addLayer(int size, ActivationType _activationType) {
     if (!layers.empty()) {
         layers.emplace_back(layers[layers.size()-1].getNeuronCount(), size, _activationType);
@@ -29,8 +66,22 @@ void NeuralNetwork::addLayer(int size, ActivationType _activationType) {
 void NeuralNetwork::adjustFirstLayer(int _input_size, ActivationType _activationType) {
     try {
         int firstLayerSize = layers[0].getNeuronCount();
+        WeightPrecision precision = layers[0].getWeightPrecision();
+        ActivationAccuracy accuracy = layers[0].getActivationAccuracy();
+        bool tensor_parallel = layers[0].usesTensorParallel();
+        bool sparse_kernels = layers[0].usesSparseKernels();
+        std::vector<uint8_t> mask = layers[0].getWeightMask(); // the pruning pattern still fits the same input size
+        if (!mask.empty() && layers[0].getInputCount() != static_cast<unsigned long>(_input_size)) {
+            std::cerr << "Warning: the first layer's pruning mask is for " << layers[0].getInputCount() << " inputs, dropping it" << std::endl;
+            mask.clear();
+        }
         layers.erase(layers.begin()); // delete first element
         layers.insert(layers.begin(), Layer(_input_size, firstLayerSize, _activationType));
+        layers[0].setWeightMask(std::move(mask));
+        layers[0].setSparseKernels(sparse_kernels);
+        layers[0].setWeightPrecision(precision);
+        layers[0].setActivationAccuracy(accuracy);
+        layers[0].setTensorParallel(tensor_parallel);
         input_size = _input_size;
     }
     catch (...) {
@@ -38,21 +89,88 @@ void NeuralNetwork::adjustFirstLayer(int _input_size, ActivationType _activation
     }
 }
 
+int NeuralNetwork::startTraining(size_t inputlayer_size, int epoch) {
+    if (isInferenceOnly()) {
+        std::cerr << "Error: the network was compacted for inference and can't be trained" << std::endl;
+        return -1;
+    }
+    int first_epoch = resume_epoch;
+    if (first_epoch > 0 && input_size == inputlayer_size && epoch <= first_epoch) { // kept for a fit with a larger count
+        std::cerr << "Warning: resuming at epoch " << first_epoch << ", the epoch count " << epoch
+                  << " is a total and leaves nothing to train (pass " << first_epoch << " + the epochs to add)" << std::endl;
+        return -1;
+    }
+    resume_epoch = 0;
+    if (first_epoch > 0 && input_size == inputlayer_size) return first_epoch;
+    if (first_epoch > 0) std::cerr << "Warning: checkpoint is for " << input_size << " inputs, starting over" << std::endl;
+    adjustFirstLayer(static_cast<int>(inputlayer_size), layers[0].getActivationType()); // change the shape of the first layer according to the input layer shape.
+    return 0;
+}
+
+TrainingState NeuralNetwork::trainingState(int next_epoch) const {
+    TrainingState state;
+    state.next_epoch = next_epoch;
+    state.learning_rate = eta;
+    state.gradient_descent_type = gradient_descent_type;
+    state.mini_batch_size = mini_batch_size;
+    state.rng = rng;
+    return state;
+}
+
+void NeuralNetwork::setCheckpointing(const std::string& path, int every_epochs) {
+    checkpoint_path = path;
+    checkpoint_interval = path.empty() ? 0 : std::max(every_epochs, 0);
+}
+
+bool NeuralNetwork::loadCheckpoint(const std::string& path) {
+    TrainingState state;
+    if (!readCheckpoint(path, input_size, layers, state)) return false;
+    resume_epoch = state.next_epoch;
+    eta = state.learning_rate;
+    gradient_descent_type = state.gradient_descent_type;
+    mini_batch_size = state.mini_batch_size;
+    rng = state.rng;
+    return true;
+}
+
+void NeuralNetwork::setSeed(unsigned int seed) {
+    rng.seed(seed);
+}
+
+void NeuralNetwork::resumeAt(int epoch) {
+    resume_epoch = std::max(epoch, 0);
+}
+
+void NeuralNetwork::setVerbose(bool _verbose) {
+    verbose = _verbose;
+}
+
+bool NeuralNetwork::isVerbose() const {
+    return verbose;
+}
+
+std::mt19937& NeuralNetwork::getRng() {
+    return rng;
+}
+
 void NeuralNetwork::forwardProp(const std::vector<double> &input_vector) {
     try {
         if (input_vector.size() != input_size) throw std::runtime_error("input vector size doesn't match with trained network's input size");
 
-        auto input_layer = Layer(input_vector); // craete input_layer from input,
-        layers[0].forward(input_layer);
-        for (int i=1; i<layers.size(); ++i) { // forward every layers for forward propagation
-            layers[i].forward(layers[i-1]);
-        }
+        forwardProp(input_vector.data());
     }
     catch (const std::runtime_error& e) {
         std::cerr << "Error: " << e.what() << std::endl;
     }
 }
 
+void NeuralNetwork::forwardProp(const double* input_vector) {
+    layers[0].forward(input_vector, input_size); // the first layer reads the input directly (no temporary input Layer)
+    for (int i=1; i<layers.size(); ++i) { // forward every layers for forward propagation
+        layers[i].forward(layers[i-1]);
+    }
+}
+
 std::vector<double> NeuralNetwork::predict(const std::vector<double> &input_vector) {
     forwardProp(input_vector);
     return layers[layers.size()-1].getOutputVector();
@@ -67,37 +185,115 @@ std::vector<std::vector<double>> NeuralNetwork::predict(const std::vector<std::v
     return predictions;
 }
 
-double NeuralNetwork::cost_compute(const std::vector<std::vector<double>> &X_train, const std::vector<std::vector<double>> &Y_train, LossFxn loss_fxn) {
-    size_t sample_size = X_train.size();
-    double cost = 0;
-    for (int i=0; i<sample_size; ++i) {
-        double loss = 0;
-        auto Yhat_vector = predict(X_train[i]);
-        auto& Y_vector = Y_train[i];
-        switch (loss_fxn) {
-            case MSE:
-                if (Yhat_vector.size() == 1)
-                    loss = loss_MSE(Yhat_vector[0], Y_vector[0]);
-                else
-                    loss = multi_output_MSE(Yhat_vector, Y_vector);
-                break;
-            case BinaryCrossEntropy:
-                if (Yhat_vector.size() == 1)
-                    loss = loss_BinaryCrossEntropy(Yhat_vector[0], Y_vector[0]);
-                break;
-            case CategoricalCrossEntropy:
-                if (Yhat_vector.size() > 1)
-                    loss = loss_CategoricalCrossEntropy(Yhat_vector, Y_vector);
-                break;
-            default:
-                break;
+std::vector<std::vector<double>> NeuralNetwork::predict(const MappedDataset &dataset) {
+    std::vector<std::vector<double>> predictions;
+    if (dataset.getFeatureCount() != input_size) {
+        std::cerr << "Error: dataset feature count doesn't match with trained network's input size" << std::endl;
+        return predictions;
+    }
+    predictions.reserve(dataset.getRowCount());
+    std::vector<double> scratch; // only used when the rows aren't stored as contiguous doubles
+    for (size_t i=0; i<dataset.getRowCount(); ++i) {
+        forwardProp(dataset.features(i, scratch));
+        predictions.push_back(layers[layers.size()-1].getOutputVector());
+    }
+    return predictions;
+}
+
+std::vector<double> NeuralNetwork::predictBatch(const double* input_vectors, size_t batch_size) const {
+    std::vector<double> buffers[2];
+    const double* output = forwardBatch(input_vectors, batch_size, buffers);
+    return std::vector<double>(output, output + batch_size * layers.back().getNeuronCount());
+}
+
+const double* NeuralNetwork::forwardBatch(const double* input_vectors, size_t batch_size, std::vector<double> (&buffers)[2]) const {
+    // ping-pong between two activation buffers, sized for the widest layer. resizing keeps their capacity
+    unsigned long max_width = getMaxNeuronInLayer();
+    for (auto& buffer : buffers) buffer.resize(batch_size * max_width);
+    const double* input = input_vectors;
+    size_t input_n = input_size;
+    for (size_t l=0; l<layers.size(); ++l) {
+        double* output = buffers[l % 2].data();
+        layers[l].forwardBatch(input, input_n, batch_size, output);
+        input = output;
+        input_n = layers[l].getNeuronCount();
+    }
+    return input;
+}
+
+void NeuralNetwork::prepareCostScratch(size_t sample_size) {
+    size_t chunk_count = (sample_size + cost_chunk_rows - 1) / cost_chunk_rows;
+    chunk_costs.resize(chunk_count);
+    cost_scratch.resize(std::max<size_t>(1, std::min(ThreadPool::global().size(), chunk_count)));
+    size_t max_width = getMaxNeuronInLayer();
+    for (auto& scratch : cost_scratch) {
+        scratch.X.resize(cost_chunk_rows * input_size);
+        for (auto& buffer : scratch.activations) buffer.reserve(cost_chunk_rows * max_width);
+    }
+}
+
+template <typename Samples>
+double NeuralNetwork::costSamples(Samples &samples, size_t sample_size, LossFxn loss_fxn) {
+    bool tracking = false;
+    for (const auto& layer : layers) tracking = tracking || layer.tracksActivations();
+    if (tracking) { // the activation counts come from forwardProp
+        double cost = 0;
+        for (size_t i=0; i<sample_size; ++i) {
+            forwardProp(samples.x(i));
+            cost += loss_compute(loss_fxn, layers[layers.size()-1].getOutputVector(), samples.y(i));
         }
-        cost += loss;
+        cost /= static_cast<double>(sample_size);
+        return cost;
     }
+    // chunks of rows through the batched forward pass on the pool, one lane of chunks per thread with its own
+    // reused buffers (sized by prepareCostScratch, so the epoch loop doesn't allocate). the partial sums are
+    // added in chunk order, so the cost doesn't depend on the thread count
+    prepareCostScratch(sample_size);
+    size_t chunk_count = chunk_costs.size(), lanes = cost_scratch.size(), out_n = layers.back().getNeuronCount();
+    auto lane = [&](size_t l) {
+        CostScratch& scratch = cost_scratch[l];
+        for (size_t c=l; c<chunk_count; c+=lanes) {
+            size_t first = c * cost_chunk_rows, rows = std::min(cost_chunk_rows, sample_size - first);
+            for (size_t r=0; r<rows; ++r) {
+                const double* x = samples.x(first + r, scratch.x_scratch);
+                std::copy(x, x + input_size, scratch.X.begin() + r*input_size);
+            }
+            const double* y_hat = forwardBatch(scratch.X.data(), rows, scratch.activations);
+            double cost = 0;
+            for (size_t r=0; r<rows; ++r) {
+                cost += loss_compute(loss_fxn, y_hat + r*out_n, samples.y(first + r, scratch.y_scratch), out_n);
+            }
+            chunk_costs[c] = cost;
+        }
+    };
+    ThreadPool::global().parallelFor(lanes, std::cref(lane)); // a std::function holds a reference_wrapper without allocating
+    double cost = std::accumulate(chunk_costs.begin(), chunk_costs.end(), 0.0);
     cost /= static_cast<double>(sample_size);
     return cost;
 }
 
+double NeuralNetwork::cost_compute(const std::vector<std::vector<double>> &X_train, const std::vector<std::vector<double>> &Y_train, LossFxn loss_fxn) {
+    if (!X_train.empty() && X_train[0].size() != input_size) {
+        std::cerr << "Error: input vector size doesn't match with trained network's input size" << std::endl;
+        return 0;
+    }
+    VectorSamples samples{X_train, Y_train};
+    return costSamples(samples, X_train.size(), loss_fxn);
+}
+
+double NeuralNetwork::cost_compute(const MappedDataset &dataset, LossFxn loss_fxn) {
+    if (dataset.getFeatureCount() != input_size) {
+        std::cerr << "Error: dataset feature count doesn't match with trained network's input size" << std::endl;
+        return 0;
+    }
+    if (dataset.getLabelCount() != layers.back().getNeuronCount()) {
+        std::cerr << "Error: dataset label count doesn't match with the output layer's size" << std::endl;
+        return 0;
+    }
+    MappedSamples samples{dataset, {}, {}};
+    return costSamples(samples, dataset.getRowCount(), loss_fxn);
+}
+
 double NeuralNetwork::getLearningRate() const {
     return eta;
 }
@@ -119,66 +315,90 @@ void NeuralNetwork::clearAllWeightBiasGradients() {
     }
 }
 
-void NeuralNetwork::fit(const std::vector<std::vector<double>> &X_train, const std::vector<std::vector<double>> &Y_train, int epoch, LossFxn loss_fxn = MSE, NetDrawer *drawer) {
-    size_t sample_size = X_train.size();
-    size_t inputlayer_size = X_train[0].size();
-    size_t layer_size  = layers.size();
+void NeuralNetwork::fit(const std::vector<std::vector<double>> &X_train, const std::vector<std::vector<double>> &Y_train, int epoch, LossFxn loss_fxn, NetDrawer *drawer) {
+    VectorSamples samples{X_train, Y_train};
+    fitSamples(samples, X_train.size(), X_train[0].size(), epoch, loss_fxn, drawer);
+}
+
+void NeuralNetwork::fit(const MappedDataset &dataset, int epoch, LossFxn loss_fxn, NetDrawer *drawer) {
+    if (dataset.getRowCount() == 0) {
+        std::cerr << "Error: dataset is empty or unreadable" << std::endl;
+        return;
+    }
+    if (dataset.getLabelCount() != layers.back().getNeuronCount()) { // the loss reads a full output row of labels
+        std::cerr << "Error: dataset label count doesn't match with the output layer's size" << std::endl;
+        return;
+    }
+    MappedSamples samples{dataset, {}, {}};
+    fitSamples(samples, dataset.getRowCount(), dataset.getFeatureCount(), epoch, loss_fxn, drawer);
+}
+
+template <typename Samples>
+void NeuralNetwork::fitSamples(Samples &samples, size_t sample_size, size_t inputlayer_size, int epoch, LossFxn loss_fxn, NetDrawer *drawer) {
     size_t batch_size = sample_size;
     switch(gradient_descent_type) {
         case SGD:
             batch_size = 1;
         break;
-        case MiniBatch:
-            batch_size = mini_batch_size;
+        case MiniBatch: // mini_batch_size below 1 is a ratio of the samples, otherwise a sample count
+            batch_size = mini_batch_size < 1 ? static_cast<size_t>(mini_batch_size * sample_size) : static_cast<size_t>(mini_batch_size);
+            batch_size = std::min(std::max<size_t>(batch_size, 1), sample_size);
         break;
         case Batch:
             break;
         default:
             break;
     }
-    std::vector<std::vector<double>> X_train_use(batch_size, std::vector<double>(inputlayer_size));
-    std::vector<std::vector<double>> Y_train_use(batch_size, std::vector<double>(Y_train[0].size()));
-
+    // the epoch loop only shuffles indices into the samples, so it doesn't copy rows or allocate
+    std::vector<size_t> sample_indices(sample_size);
+    std::iota(sample_indices.begin(), sample_indices.end(), 0);
+    std::vector<size_t> swapped(gradient_descent_type == MiniBatch ? batch_size : 0);
 
-    auto _activationType = layers[0].getActivationType();
-    adjustFirstLayer(static_cast<int>(inputlayer_size), _activationType); // change the shape of the first layer according to the input layer shape.
+    if (communicator && dead_neuron_interval > 0) { // each rank would remove different neurons from its own counts
+        std::cerr << "Error: dead neuron removal can't be combined with a communicator, the replicas would diverge" << std::endl;
+        return;
+    }
+    int first_epoch = startTraining(inputlayer_size, epoch);
+    if (first_epoch < 0) return;
+    prepareCostScratch(sample_size);
+    if (dead_neuron_interval > 0) trackNeuronStats(true);
+    if (communicator && !broadcastWeights()) return;
+    std::unique_ptr<CheckpointWriter> checkpoints; // waits for its last write when fit returns
+    if (checkpoint_interval > 0 && (!communicator || communicator->rank() == 0)) {
+        checkpoints.reset(new CheckpointWriter(checkpoint_path));
+    }
 
     // TODO: implement some automatic convergence using epsilon = 0.05
-    for (int _=0; _<epoch; ++_) {
+    for (int _=first_epoch; _<epoch; ++_) {
+        applyPruningSchedule(_);
+
         // comptute the cost and print
-        double cost = cost_compute(X_train, Y_train, loss_fxn);
-        std::cout << "Cost is: " << cost << std::endl;
+        double cost = costSamples(samples, sample_size, loss_fxn);
+        if (communicator) { // mean over every rank's samples
+            double totals[2] = {cost * static_cast<double>(sample_size), static_cast<double>(sample_size)};
+            if (!communicator->allReduce(totals, 2)) return;
+            cost = totals[0] / totals[1];
+        }
+        if (verbose && (!communicator || communicator->rank() == 0)) std::cout << "Cost is: " << cost << std::endl;
 
         // logic for selecting the training set for each epoch (depending on if it's SDG, mini-batch, batch)
-        // by default, batch:
+        // by default, batch: the first batch_size indices are used
         switch(gradient_descent_type) {
-            int randomIndex;
             case SGD: // randomly select one
-            {
-                randomIndex = randomNumber(0, sample_size-1);
-                X_train_use[0] = X_train[randomIndex];
-                Y_train_use[0] = Y_train[randomIndex];
-            }
+                sample_indices[0] = std::uniform_int_distribution<size_t>(0, sample_size-1)(rng);
                 break;
-            case MiniBatch: // randomly form a mini-batch
-            {
-                std::unordered_set<int> usedIndices;
-                for (int i=0; i<batch_size; ++i) {
-                    randomIndex = randomNumber(0, sample_size-1);
-                    if (usedIndices.find(randomIndex) == usedIndices.end()) {
-                        X_train_use[i] = X_train[randomIndex];
-                        Y_train_use[i] = Y_train[randomIndex];
-                        usedIndices.insert(randomIndex);
-                    }
-                    else {
-                        --i;
-                    }
+            case MiniBatch: // randomly form a mini-batch (partial Fisher-Yates, no repeated sample)
+                // from the identity order each epoch, by undoing the last epoch's swaps, so the batch depends only
+                // on the RNG and a resumed fit draws the same ones
+                for (size_t i=batch_size; i-- > 0 && _ > first_epoch;) {
+                    std::swap(sample_indices[i], sample_indices[swapped[i]]);
+                }
+                for (size_t i=0; i<batch_size; ++i) {
+                    swapped[i] = std::uniform_int_distribution<size_t>(i, sample_size-1)(rng);
+                    std::swap(sample_indices[i], sample_indices[swapped[i]]);
                 }
-            }
                 break;
             case Batch:
-                X_train_use = X_train;
-                Y_train_use = Y_train;
                 break;
         }
 
@@ -187,28 +407,21 @@ void NeuralNetwork::fit(const std::vector<std::vector<double>> &X_train, const s
         // for all sample size, do backprop
         for (int i=0; i<batch_size; ++i) {
             // 1, forward prop
-            forwardProp(X_train_use[i]);
+            forwardProp(samples.x(sample_indices[i]));
             // 2. compute deltas and weights (averaged by doing sample_size)
-            // compute delta and gradients in the last layer
-            layers[layer_size-1].computeLastLayerDelta(Y_train_use[i], loss_fxn);
-            if (layer_size == 1)// last layer is first
-                layers[layer_size-1].computeWeightGradient(X_train_use[i], batch_size);
-            else
-                layers[layer_size-1].computeWeightGradient(layers[layer_size-2], batch_size);
-            // compute delta and weight gradients in further layers.
-            for (int l=layer_size-2; l>0; --l) {
-                layers[l].computeDelta(layers[l+1]);
-                layers[l].computeWeightGradient(layers[l-1], batch_size);
-            }
-            // compute delta and weight gradients in first layer
-            if (layer_size != 1) {
-                layers[0].computeDelta(layers[1]);
-                layers[0].computeWeightGradient(X_train_use[i], batch_size);
-            }
+            backProp(samples.x(sample_indices[i]), samples.y(sample_indices[i]), loss_fxn, batch_size);
         }
         // 3. subtract the weigths for all neurons ()
+        if (communicator && !allReduceGradients(batch_size)) return;
         gradientDescent();
 
+        if (dead_neuron_interval > 0 && (_+1) % dead_neuron_interval == 0) {
+            removeDeadNeurons(dead_neuron_max_active, dead_neuron_max_weight_norm);
+        }
+        if (checkpoints && (_+1) % checkpoint_interval == 0) {
+            checkpoints->snapshot(input_size, layers, trainingState(_+1));
+        }
+
         if (drawer && _%5==0) {
             drawer->drawNetwork(*this, _, cost);
             drawer->handleEvents(); // keep window responsive
@@ -219,6 +432,103 @@ void NeuralNetwork::fit(const std::vector<std::vector<double>> &X_train, const s
     }
 }
 
+void NeuralNetwork::fit(StreamingDataset &dataset, int epoch, LossFxn loss_fxn, NetDrawer *drawer) {
+    size_t inputlayer_size = dataset.getFeatureCount();
+    size_t label_size = dataset.getLabelCount();
+    if (!dataset.isOpen() || inputlayer_size == 0) {
+        std::cerr << "Error: dataset is empty or unreadable" << std::endl;
+        return;
+    }
+    if (label_size != layers.back().getNeuronCount()) { // the loss reads a full output row of labels
+        std::cerr << "Error: dataset label count doesn't match with the output layer's size" << std::endl;
+        return;
+    }
+    int first_epoch = startTraining(inputlayer_size, epoch);
+    if (first_epoch < 0) return;
+    if (dead_neuron_interval > 0) trackNeuronStats(true);
+    std::unique_ptr<CheckpointWriter> checkpoints;
+    if (checkpoint_interval > 0) checkpoints.reset(new CheckpointWriter(checkpoint_path));
+
+    for (int _=first_epoch; _<epoch; ++_) {
+        applyPruningSchedule(_);
+
+        // out of core there is no full pass before training, the printed cost is the running cost of this epoch
+        double cost = 0;
+        size_t seen = 0;
+        dataset.rewind();
+        while (const DataChunk* chunk = dataset.nextChunk()) { // the next chunk is decoded in the background meanwhile
+            // chunks are consumed in file order. Batch takes one step per chunk, since the whole dataset is never in memory
+            size_t batch_size = chunk->rows;
+            switch(gradient_descent_type) {
+                case SGD:
+                    batch_size = 1;
+                    break;
+                case MiniBatch:
+                    batch_size = mini_batch_size < 1 ? static_cast<size_t>(mini_batch_size * chunk->rows) : static_cast<size_t>(mini_batch_size);
+                    batch_size = std::min(std::max<size_t>(batch_size, 1), chunk->rows);
+                    break;
+                default:
+                    break;
+            }
+            for (size_t start=0; start<chunk->rows; start+=batch_size) {
+                size_t end = std::min(start+batch_size, chunk->rows);
+                clearAllWeightBiasGradients();
+                for (size_t i=start; i<end; ++i) {
+                    const double* X_row = &chunk->features[i*inputlayer_size]; // rows are trained in place in the chunk
+                    const double* Y_row = &chunk->labels[i*label_size];
+                    forwardProp(X_row);
+                    cost += loss_compute(loss_fxn, layers[layers.size()-1].getOutputVector(), Y_row);
+                    backProp(X_row, Y_row, loss_fxn, static_cast<int>(end-start));
+                }
+                gradientDescent();
+                seen += end-start;
+            }
+        }
+        if (seen == 0) {
+            std::cerr << "Error: dataset is empty or unreadable" << std::endl;
+            return;
+        }
+        cost /= static_cast<double>(seen);
+        if (verbose) std::cout << "Cost is: " << cost << std::endl;
+
+        if (dead_neuron_interval > 0 && (_+1) % dead_neuron_interval == 0) {
+            removeDeadNeurons(dead_neuron_max_active, dead_neuron_max_weight_norm);
+        }
+        if (checkpoints && (_+1) % checkpoint_interval == 0) {
+            checkpoints->snapshot(input_size, layers, trainingState(_+1));
+        }
+
+        if (drawer && _%5==0) {
+            drawer->drawNetwork(*this, _, cost);
+            drawer->handleEvents(); // keep window responsive
+        }
+    }
+}
+
+void NeuralNetwork::backProp(const std::vector<double> &input_vector, const std::vector<double> &Y_vector, LossFxn loss_fxn, int batch_size) {
+    backProp(input_vector.data(), Y_vector.data(), loss_fxn, batch_size);
+}
+
+void NeuralNetwork::backProp(const double* input_vector, const double* Y_vector, LossFxn loss_fxn, int batch_size) {
+    size_t layer_size = layers.size();
+    // compute delta and gradients in the last layer
+    layers[layer_size-1].computeLastLayerDelta(Y_vector, loss_fxn);
+    if (layer_size == 1)// last layer is first
+        layers[layer_size-1].computeWeightGradient(input_vector, input_size, batch_size);
+    else
+        layers[layer_size-1].computeWeightGradient(layers[layer_size-2], batch_size);
+    // compute delta and weight gradients in further layers.
+    for (int l=layer_size-2; l>0; --l) {
+        layers[l].computeDelta(layers[l+1]);
+        layers[l].computeWeightGradient(layers[l-1], batch_size);
+    }
+    // compute delta and weight gradients in first layer
+    if (layer_size != 1) {
+        layers[0].computeDelta(layers[1]);
+        layers[0].computeWeightGradient(input_vector, input_size, batch_size);
+    }
+}
+
 void NeuralNetwork::gradientDescent() {
     for (auto & layer : layers) {
         layer.gradientDescent(eta);
@@ -233,6 +543,283 @@ void NeuralNetwork::setMiniBatchSize(double size) {
     mini_batch_size = size;
 }
 
+void NeuralNetwork::setWeightPrecision(WeightPrecision precision, bool keep_master) {
+    for (auto& layer : layers) {
+        layer.setWeightPrecision(precision, keep_master);
+    }
+}
+
+void NeuralNetwork::compactForInference() {
+    for (auto& layer : layers) {
+        layer.compactForInference();
+    }
+}
+
+bool NeuralNetwork::isInferenceOnly() const {
+    for (const auto& layer : layers) {
+        if (layer.isInferenceOnly()) return true;
+    }
+    return false;
+}
+
+void NeuralNetwork::setActivationAccuracy(ActivationAccuracy accuracy) {
+    for (auto& layer : layers) {
+        layer.setActivationAccuracy(accuracy);
+    }
+}
+
+void NeuralNetwork::setTensorParallel(unsigned long min_neurons) {
+    for (auto& layer : layers) {
+        layer.setTensorParallel(min_neurons > 0 && layer.getNeuronCount() >= min_neurons);
+    }
+}
+
+void NeuralNetwork::setCommunicator(Communicator* _communicator) {
+    communicator = _communicator;
+}
+
+Communicator* NeuralNetwork::getCommunicator() const {
+    return communicator;
+}
+
+bool NeuralNetwork::broadcastWeights() {
+    if (!communicator) return true;
+    // an all-reduce where every rank but 0 contributes zeros
+    communication_buffer.clear();
+    bool root = communicator->rank() == 0;
+    for (const auto& layer : layers) {
+        for (const auto& neuron : layer.getNeuronsReadOnly()) {
+            for (double weight : neuron.weights) communication_buffer.push_back(root ? weight : 0.0);
+            communication_buffer.push_back(root ? neuron.bias : 0.0);
+        }
+    }
+    if (!communicator->allReduce(communication_buffer.data(), communication_buffer.size())) {
+        std::cerr << "Error: cannot get the initial weights from rank 0" << std::endl;
+        return false;
+    }
+    const double* value = communication_buffer.data();
+    for (auto& layer : layers) {
+        for (auto& neuron : layer.getNeurons()) {
+            for (double& weight : neuron.weights) weight = *value++;
+            neuron.bias = *value++;
+        }
+        if (layer.getWeightPrecision() != FullPrecision || layer.usesSparseKernels()) layer.repackWeights();
+    }
+    return true;
+}
+
+bool NeuralNetwork::allReduceGradients(size_t batch_size) {
+    // each rank's gradients are means over its own batch: weight them by its share of all ranks' samples and sum.
+    // the share is summed exactly first, the gradients may go through the transport's compression
+    double total = static_cast<double>(batch_size);
+    if (!communicator->allReduce(&total, 1)) {
+        std::cerr << "Error: gradient all-reduce failed, stopping fit" << std::endl;
+        return false;
+    }
+    double share = static_cast<double>(batch_size) / total;
+    communication_buffer.clear();
+    for (const auto& layer : layers) {
+        layer.appendGradients(communication_buffer, share);
+    }
+    if (!communicator->allReduceGradients(communication_buffer.data(), communication_buffer.size(), 0)) {
+        std::cerr << "Error: gradient all-reduce failed, stopping fit" << std::endl;
+        return false;
+    }
+    const double* value = communication_buffer.data();
+    for (auto& layer : layers) {
+        value = layer.setGradients(value);
+    }
+    return true;
+}
+
+void NeuralNetwork::setPruningSchedule(const PruningSchedule& schedule) {
+    pruning_schedule = schedule;
+}
+
+void NeuralNetwork::trackNeuronStats(bool enabled) {
+    for (auto& layer : layers) {
+        layer.setActivationTracking(enabled);
+    }
+}
+
+size_t NeuralNetwork::removeDeadNeurons(double max_active_fraction, double max_weight_norm) {
+    size_t removed = 0;
+    for (size_t l=0; l+1<layers.size(); ++l) { // the output layer's shape is fixed by the labels
+        if (layers[l].getActivationType() != RELU) continue;
+        auto stats = layers[l].getNeuronStats();
+        std::vector<size_t> dead;
+        for (size_t i=0; i<stats.size(); ++i) {
+            // a neuron whose weights decayed to about zero outputs its bias alone, whatever the input
+            if (stats[i].active_fraction <= max_active_fraction || stats[i].weight_norm <= max_weight_norm) dead.push_back(i);
+        }
+        if (dead.size() == stats.size()) dead.pop_back(); // keep the layer connected
+        layers[l].removeNeurons(dead);
+        layers[l+1].removeInputs(dead);
+        removed += dead.size();
+    }
+    for (auto& layer : layers) {
+        layer.resetActivationStats();
+    }
+    if (removed && verbose) {
+        std::cout << "Removed " << removed << " dead neurons, layer sizes:";
+        for (const auto& layer : layers) std::cout << " " << layer.getNeuronCount();
+        std::cout << std::endl;
+    }
+    return removed;
+}
+
+void NeuralNetwork::setDeadNeuronRemoval(int every_epochs, double max_active_fraction, double max_weight_norm) {
+    dead_neuron_interval = every_epochs;
+    dead_neuron_max_active = max_active_fraction;
+    dead_neuron_max_weight_norm = max_weight_norm;
+}
+
+void NeuralNetwork::applyPruningSchedule(int epoch) {
+    if (!pruning_schedule.prunesAt(epoch)) return;
+    pruneByMagnitude(layers, pruning_schedule.sparsityAt(epoch), pruning_schedule.scope, pruning_schedule.sparse_kernel_threshold);
+}
+
+std::vector<LayerProfile> NeuralNetwork::profileLayers(const std::vector<std::vector<double>> &X_train, const std::vector<std::vector<double>> &Y_train, LossFxn loss_fxn) {
+    using Clock = std::chrono::steady_clock;
+    auto elapsed = [](const Clock::time_point& start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    };
+
+    size_t layer_size = layers.size();
+    std::vector<LayerProfile> profiles;
+    for (unsigned long l=0; l<layer_size; ++l) {
+        for (auto phase : {ForwardPass, BackwardPass, WeightUpdate}) {
+            profiles.push_back({l, phase, 0, 0, 0});
+        }
+    }
+    if (X_train.empty() || X_train[0].size() != input_size) {
+        std::cerr << "Error: profile samples don't match with trained network's input size" << std::endl;
+        return profiles;
+    }
+    if (isInferenceOnly()) {
+        std::cerr << "Error: the network was compacted for inference, the backward pass can't be profiled" << std::endl;
+        return profiles;
+    }
+
+    clearAllWeightBiasGradients();
+    int sample_size = static_cast<int>(X_train.size());
+    for (int i=0; i<sample_size; ++i) {
+        for (size_t l=0; l<layer_size; ++l) {
+            auto start = Clock::now();
+            if (l == 0)
+                layers[l].forward(X_train[i].data(), input_size);
+            else
+                layers[l].forward(layers[l-1]);
+            profiles[3*l].seconds += elapsed(start);
+        }
+        for (size_t l=layer_size; l-- > 0;) {
+            auto start = Clock::now();
+            if (l == layer_size-1)
+                layers[l].computeLastLayerDelta(Y_train[i], loss_fxn);
+            else
+                layers[l].computeDelta(layers[l+1]);
+            if (l == 0)
+                layers[l].computeWeightGradient(X_train[i], sample_size);
+            else
+                layers[l].computeWeightGradient(layers[l-1], sample_size);
+            profiles[3*l+1].seconds += elapsed(start);
+        }
+    }
+    for (size_t l=0; l<layer_size; ++l) {
+        auto start = Clock::now();
+        layers[l].gradientDescent(0.0); // same memory traffic and arithmetic as a real step, without moving the weights
+        profiles[3*l+2].seconds += elapsed(start);
+    }
+    clearAllWeightBiasGradients();
+
+    for (auto& profile : profiles) {
+        unsigned long next_n = profile.layer+1 < layer_size ? layers[profile.layer+1].getNeuronCount() : 0;
+        double repeat = profile.phase == WeightUpdate ? 1 : sample_size; // one update per pass, not per sample
+        profile.flops = layers[profile.layer].flopCount(profile.phase, next_n) * repeat;
+        profile.bytes = layers[profile.layer].byteCount(profile.phase, next_n) * repeat;
+    }
+    return profiles;
+}
+
+bool NeuralNetwork::saveModel(const std::string& path) const {
+    if (isInferenceOnly()) {
+        std::cerr << "Error: the network was compacted for inference, its double weights are gone" << std::endl;
+        return false;
+    }
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Cannot write model file: " << path << std::endl;
+        return false;
+    }
+    writeModel(file, input_size, layers);
+    return static_cast<bool>(file);
+}
+
+void NeuralNetwork::writeModel(std::ostream& file, unsigned int input_size, const std::vector<Layer>& layers) {
+    file << std::setprecision(17);
+    file << "NNMODEL 1\n" << input_size << " " << layers.size() << "\n";
+    for (const auto& layer : layers) {
+        file << layer.getNeuronCount() << " " << layer.getActivationType() << "\n";
+        for (const auto& neuron : layer.getNeuronsReadOnly()) {
+            file << neuron.bias;
+            for (const auto& weight : neuron.weights) {
+                file << " " << weight;
+            }
+            file << "\n";
+        }
+    }
+}
+
+bool NeuralNetwork::loadModel(const std::string& path) {
+    std::ifstream file(path);
+    if (!readModel(file, path, input_size, layers)) return false;
+    resume_epoch = 0; // fresh weights, a resume from an earlier loadCheckpoint doesn't apply
+    return true;
+}
+
+bool NeuralNetwork::readModel(std::istream& file, const std::string& name, unsigned int& input_size, std::vector<Layer>& layers) {
+    std::string magic;
+    int version = 0;
+    unsigned int _input_size = 0;
+    size_t layer_count = 0;
+    if (!(file >> magic >> version >> _input_size >> layer_count) || magic != "NNMODEL" || version != 1) {
+        std::cerr << "Not a model file: " << name << std::endl;
+        return false;
+    }
+    // the sizes are allocated before the weights are read, so a corrupt file mustn't ask for gigabytes
+    const unsigned long max_width = 1ul << 20, max_layer_weights = 1ul << 28;
+    if (layer_count == 0 || layer_count > max_width || _input_size == 0 || _input_size > max_width) {
+        std::cerr << "Corrupt model file: " << name << std::endl;
+        return false;
+    }
+    std::vector<Layer> _layers;
+    unsigned long prev_n = _input_size;
+    for (size_t l=0; l<layer_count; ++l) {
+        unsigned long size = 0;
+        int activation = 0;
+        if (!(file >> size >> activation) || activation < LINEAR || activation > SOFTMAX
+            || size == 0 || size > max_width || size * prev_n > max_layer_weights) {
+            std::cerr << "Corrupt model file: " << name << std::endl;
+            return false;
+        }
+        _layers.emplace_back(prev_n, size, static_cast<ActivationType>(activation));
+        for (auto& neuron : _layers.back().getNeurons()) {
+            file >> neuron.bias;
+            for (auto& weight : neuron.weights) {
+                file >> weight;
+            }
+        }
+        prev_n = size;
+    }
+    if (!file) {
+        std::cerr << "Corrupt model file: " << name << std::endl;
+        return false;
+    }
+    layers = std::move(_layers);
+    input_size = _input_size;
+    return true;
+}
+
 void NeuralNetwork::printDeltaAndWeights() const {
     for (size_t layer_idx = 0; layer_idx < layers.size(); ++layer_idx) {
         std::cout << "Layer " << layer_idx + 1 << ":\n";
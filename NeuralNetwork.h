@@ -5,9 +5,18 @@
 #ifndef NEURALNETWORK_H
 #define NEURALNETWORK_H
 
+#include <iosfwd>
+#include <random>
+#include <string>
 #include <vector>
+#include "Checkpoint.h"
+#include "Communicator.h"
 #include "Layer.h"
 #include "NetDrawer.h"
+#include "Roofline.h"
+#include "StreamingDataset.h"
+#include "MappedDataset.h"
+#include "Pruning.h"
 #include "utility.h"
 
 class NetDrawer;
@@ -20,14 +29,49 @@ class NeuralNetwork {
     double epsilon; // (for automatic convergence
     GradientDescentType gradient_descent_type;
     double mini_batch_size;
+    PruningSchedule pruning_schedule;
+    int dead_neuron_interval; // epochs between removeDeadNeurons calls in fit, 0 = off
+    double dead_neuron_max_active;
+    double dead_neuron_max_weight_norm; // < 0 = weight norms aren't a criterion
+    Communicator* communicator; // data-parallel replicas to average gradients with, nullptr = train alone
+    std::vector<double> communication_buffer;
+    std::mt19937 rng; // sample shuffling in fit, part of a checkpoint
+    std::string checkpoint_path;
+    int checkpoint_interval; // epochs between checkpoints in fit, 0 = off
+    int resume_epoch; // set by loadCheckpoint for the next fit
+    bool verbose; // fit prints the cost of every epoch
+    struct CostScratch { // one per thread of the cost pass
+        std::vector<double> X; // a chunk of rows, contiguous
+        std::vector<double> x_scratch, y_scratch; // decoded mapped rows
+        std::vector<double> activations[2];
+    };
+    std::vector<CostScratch> cost_scratch;
+    std::vector<double> chunk_costs;
+
+    void applyPruningSchedule(int epoch);
+    // shapes the first layer unless resuming, returns the first epoch, -1 if a resumed fit has nothing left to train
+    int startTraining(size_t inputlayer_size, int epoch);
+    TrainingState trainingState(int next_epoch) const;
+    bool allReduceGradients(size_t batch_size); // replaces the local gradients by the mean over every rank's samples
+    template <typename Samples>
+    void fitSamples(Samples &samples, size_t sample_size, size_t inputlayer_size, int epoch, LossFxn, NetDrawer *drawer);
+    template <typename Samples>
+    double costSamples(Samples &samples, size_t sample_size, LossFxn);
+    void prepareCostScratch(size_t sample_size); // sizes the buffers above, a no-op once they fit
+    // predictBatch into the given buffers, returns the output inside one of them
+    const double* forwardBatch(const double* input_vectors, size_t batch_size, std::vector<double> (&buffers)[2]) const;
 
 public:
     NeuralNetwork()
-        : input_size(1), eta(0.05), epsilon(0), gradient_descent_type(Batch), mini_batch_size(0.1) {
+        : input_size(1), eta(0.05), epsilon(0), gradient_descent_type(Batch), mini_batch_size(0.1),
+          dead_neuron_interval(0), dead_neuron_max_active(0), dead_neuron_max_weight_norm(-1), communicator(nullptr),
+          rng(std::random_device{}()), checkpoint_interval(0), resume_epoch(0), verbose(true) {
     }
 
     explicit NeuralNetwork(const std::vector<int>& layer_configuration)
-        : input_size(1), eta(0.05), epsilon(0), gradient_descent_type(Batch), mini_batch_size(0.1) {
+        : input_size(1), eta(0.05), epsilon(0), gradient_descent_type(Batch), mini_batch_size(0.1),
+          dead_neuron_interval(0), dead_neuron_max_active(0), dead_neuron_max_weight_norm(-1), communicator(nullptr),
+          rng(std::random_device{}()), checkpoint_interval(0), resume_epoch(0), verbose(true) {
         layers.emplace_back(1, layer_configuration[0]);
         // temporary first layer (needs to change depending on the input layer size later)
         for (int i = 1; i < layer_configuration.size(); ++i) {
@@ -36,23 +80,90 @@ public:
     }
 
     const std::vector<Layer>& getLayerReadOnly() const;
+    std::vector<Layer>& getLayers(); // for graph passes (GraphOptimizer) that rewrite the layers in place
     unsigned long getMaxNeuronInLayer() const;
+    unsigned int getInputSize() const;
     void addLayer(int size, ActivationType);
     void adjustFirstLayer(int input_size, ActivationType = SIGMOID);
+    void forwardProp(const double* input_vector); // input_size values, no size check
     void forwardProp(const std::vector<double> &); // the difference btw forwardProp and predict is only that predict returns a the last layer's output (y_hat).
     std::vector<double> predict(const std::vector<double>&);
     std::vector<std::vector<double>> predict(const std::vector<std::vector<double>>&);
+    std::vector<std::vector<double>> predict(const MappedDataset&);
+    // batch x input_size row-major in, batch x output size out. const: safe to call from many threads at once
+    std::vector<double> predictBatch(const double* input_vectors, size_t batch_size) const;
     double cost_compute(const std::vector<std::vector<double>> &X_train, const std::vector<std::vector<double>> &Y_train, LossFxn loss_fxn = MSE);
+    double cost_compute(const MappedDataset &dataset, LossFxn loss_fxn = MSE);
     double getLearningRate() const;
     void setLearningRate(const double&);
     void clearAllDeltas();
     void clearAllWeightBiasGradients();
-    void fit(const std::vector<std::vector<double>> &X_train, const std::vector<std::vector<double>> &Y_train, int epoch, LossFxn, NetDrawer *drawer = nullptr);
+    void backProp(const std::vector<double> &input_vector, const std::vector<double> &Y_vector, LossFxn, int batch_size); // prereq: forwardProp on the same input. accumulates gradients (averaged by batch_size)
+    void backProp(const double* input_vector, const double* Y_vector, LossFxn, int batch_size);
+    void fit(const std::vector<std::vector<double>> &X_train, const std::vector<std::vector<double>> &Y_train, int epoch, LossFxn loss_fxn = MSE, NetDrawer *drawer = nullptr);
+    void fit(const MappedDataset &dataset, int epoch, LossFxn loss_fxn = MSE, NetDrawer *drawer = nullptr); // rows are read in place from the mapping
+    // out of core training: one pass over the file per epoch, the next chunk is prefetched while the current one trains
+    void fit(StreamingDataset &dataset, int epoch, LossFxn loss_fxn = MSE, NetDrawer *drawer = nullptr);
     void gradientDescent(); // prereq: gradients are alrdy calculated
     void setGradientDescentType(GradientDescentType);
     void setMiniBatchSize(double ratio);
+    // every layer's forward pass reads 16-bit copies of its weights with float accumulation (see Layer). set it after
+    // the layers are added; fit keeps it, loadModel resets to FullPrecision. keep_master = false also drops the double
+    // weights (compactForInference), a trained model then takes 2 bytes per weight but can only run inference
+    void setWeightPrecision(WeightPrecision, bool keep_master = true);
+    // frees the double weights, gradients and masks of every layer on sparse or 16-bit kernels (see
+    // Layer::compactForInference). afterwards fit, the trainers, profiling, pruning and saveModel are refused
+    void compactForInference();
+    bool isInferenceOnly() const; // some layer was compacted
+    // exact libm, polynomial or table SIGMOID/TANH in every layer; derivatives always come from the cached outputs
+    void setActivationAccuracy(ActivationAccuracy);
+    // splits each layer with at least min_neurons neurons across the ThreadPool (Layer::setTensorParallel),
+    // 0 turns it off. for single-sample latency on very wide layers; set it after the layers are added
+    void setTensorParallel(unsigned long min_neurons);
+    // gradual magnitude pruning inside fit (epochs counted per fit call), see PruningSchedule
+    void setPruningSchedule(const PruningSchedule&);
+    // per neuron activation counts over every forward pass (training and cost), read with Layer::getNeuronStats
+    void trackNeuronStats(bool);
+    // removes the hidden RELU neurons active in at most max_active_fraction of the tracked samples, or whose incoming
+    // weight norm is at most max_weight_norm (off when negative), together with the next layer's weights reading
+    // them, then restarts the counts. returns the number of neurons removed, and prints the new layer sizes when verbose
+    size_t removeDeadNeurons(double max_active_fraction = 0, double max_weight_norm = -1);
+    // done inside fit, 0 epochs = off
+    void setDeadNeuronRemoval(int every_epochs, double max_active_fraction = 0, double max_weight_norm = -1);
+    // data-parallel training: each process runs fit on its own shard with the same network shape, epochs and
+    // settings. fit starts every rank from rank 0's weights and averages the gradients over all ranks' samples
+    // before each update, so the replicas stay identical; the cost is averaged too and only rank 0 prints it.
+    // in-memory and mapped datasets only (the streaming fit ignores it). fit refuses dead neuron removal with it,
+    // whose counts are per rank. nullptr (the default) trains alone
+    void setCommunicator(Communicator*);
+    Communicator* getCommunicator() const;
+    bool broadcastWeights(); // every rank takes rank 0's weights, fit does this itself
+    // fit writes a checkpoint (weights, learning rate and batch settings, the next epoch and the shuffling RNG) to
+    // path every every_epochs epochs. the file is written in the background (CheckpointWriter), fit only waits
+    // for it before returning. with a communicator only rank 0 writes. 0 epochs = off
+    void setCheckpointing(const std::string& path, int every_epochs);
+    // restores a checkpoint, and the next fit carries on from its epoch instead of re-initializing the first layer
+    // (epoch counts stay totals: fit warns and trains nothing unless its count is past the checkpoint's epoch).
+    // loadModel's precision caveat applies
+    bool loadCheckpoint(const std::string& path);
+    void setSeed(unsigned int seed); // of the sample shuffling, random by default
+    // the next fit continues the current weights from epoch (what loadCheckpoint does in memory), e.g. to train
+    // further with a larger total epoch count
+    void resumeAt(int epoch);
+    void setVerbose(bool); // whether fit prints the cost every epoch (and removed neurons), on by default
+    bool isVerbose() const;
+    std::mt19937& getRng(); // setSeed's generator, for trainers that shuffle samples on the network's behalf
+    // per layer and phase flop/byte counts with measured time, over one pass of the samples. weights are left untouched
+    std::vector<LayerProfile> profileLayers(const std::vector<std::vector<double>> &X_train, const std::vector<std::vector<double>> &Y_train, LossFxn loss_fxn = MSE);
     friend void NetDrawer::drawNetwork(const NeuralNetwork&, int epoch, double cost);
 
+    // plain text, full precision: input size, then every layer's shape, activation, biases and weights
+    // reading refuses a file without layers, or with a layer wider than 2^20 or over 2^28 weights
+    bool saveModel(const std::string& path) const;
+    bool loadModel(const std::string& path);
+    static void writeModel(std::ostream&, unsigned int input_size, const std::vector<Layer>&);
+    static bool readModel(std::istream&, const std::string& name, unsigned int& input_size, std::vector<Layer>&); // name for errors
+
     void printDeltaAndWeights() const;
 
 };
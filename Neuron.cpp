@@ -41,6 +41,16 @@ void Neuron::computeOutput(const Layer& prev_layer, const std::function<double(d
     a = _a;
 }
 
+void Neuron::computeOutput(const double* input_vec, size_t input_n, const std::function<double(double)>& activation) {
+    double _a = 0;
+    for (size_t i=0; i<input_n; ++i) {
+        _a += input_vec[i] * weights[i];
+    }
+    _a += bias;
+    z = _a;
+    a = activation(_a);
+}
+
 void Neuron::gradientDescent(double eta) {
     for (int i=0; i<weights.size(); ++i) {
         weights[i] -= (weightGradient[i] * eta);
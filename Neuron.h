@@ -32,6 +32,7 @@ public:
     double maxWeight() const;
     double getBias() const;
     void computeOutput(const Layer& prev_layer, const std::function<double(double)>&);
+    void computeOutput(const double* input_vec, size_t input_n, const std::function<double(double)>&);
     void gradientDescent(double eta);
 
 };
@@ -0,0 +1,237 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#include "PipelineTrainer.h"
+#include "NeuralNetwork.h"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+PipelineTrainer::PipelineTrainer(NeuralNetwork& _net, unsigned int input_size, size_t stage_count,
+                                 size_t _micro_batch_size, size_t _micro_batch_count, LossFxn _loss_fxn,
+                                 size_t queue_capacity)
+    : net(_net), micro_batch_size(std::max<size_t>(_micro_batch_size, 1)),
+      micro_batch_count(std::max<size_t>(_micro_batch_count, 1)), loss_fxn(_loss_fxn) {
+    if (net.getInputSize() != input_size) {
+        net.adjustFirstLayer(static_cast<int>(input_size), net.getLayerReadOnly()[0].getActivationType());
+    }
+    const auto& layers = net.getLayerReadOnly();
+    size_t L = layers.size();
+    stage_count = std::min(std::max<size_t>(stage_count, 1), L);
+
+    // cut where the running multiply-adds pass the next multiple of total / stage_count,
+    // leaving at least one layer for each stage still to come
+    std::vector<size_t> cost(L);
+    for (size_t l=0; l<L; ++l) cost[l] = layers[l].getNeuronCount() * layers[l].getInputCount();
+    double total = static_cast<double>(std::accumulate(cost.begin(), cost.end(), size_t(0)));
+    size_t first = 0;
+    double running = 0;
+    for (size_t s=0; s<stage_count; ++s) {
+        size_t end = first + 1;
+        running += cost[first];
+        size_t last_end = L - (stage_count - s - 1);
+        while (end < last_end && running + cost[end] / 2.0 <= total * (s + 1) / stage_count) running += cost[end++];
+        if (s == stage_count - 1) end = L;
+        Stage stage;
+        stage.first_layer = first;
+        stage.end_layer = end;
+        stage.forward_ready.reset(new BoundedQueue<size_t>(queue_capacity));
+        stage.backward_ready.reset(new BoundedQueue<size_t>(queue_capacity));
+        for (size_t l=first; l<end; ++l) {
+            stage.weight_gradient.resize(std::max(stage.weight_gradient.size(), cost[l]));
+            stage.bias_gradient.resize(std::max<size_t>(stage.bias_gradient.size(), layers[l].getNeuronCount()));
+        }
+        stages.push_back(std::move(stage));
+        first = end;
+    }
+
+    activations.resize(L);
+    deltas.resize(L);
+    weight_gradients.resize(L);
+    bias_gradients.resize(L);
+    for (size_t l=0; l<L; ++l) {
+        size_t width = micro_batch_size * layers[l].getNeuronCount();
+        activations[l].assign(micro_batch_count, std::vector<double>(width));
+        bool ends_stage = false;
+        for (size_t s=0; s+1<stages.size(); ++s) ends_stage = ends_stage || stages[s].end_layer == l + 1;
+        deltas[l].assign(ends_stage ? micro_batch_count : 1, std::vector<double>(width));
+        weight_gradients[l].resize(cost[l]);
+        bias_gradients[l].resize(layers[l].getNeuronCount());
+    }
+    X.resize(getBatchSize() * input_size);
+    Y.resize(getBatchSize() * layers[L-1].getNeuronCount());
+
+    for (size_t s=0; s<stages.size(); ++s) {
+        stages[s].thread = std::thread(&PipelineTrainer::stageLoop, this, s);
+    }
+}
+
+PipelineTrainer::~PipelineTrainer() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    start_cv.notify_all();
+    for (auto& stage : stages) {
+        if (stage.thread.joinable()) stage.thread.join();
+    }
+}
+
+std::vector<std::pair<size_t, size_t>> PipelineTrainer::getStages() const {
+    std::vector<std::pair<size_t, size_t>> result;
+    for (const auto& stage : stages) result.emplace_back(stage.first_layer, stage.end_layer);
+    return result;
+}
+
+size_t PipelineTrainer::getBatchSize() const {
+    return micro_batch_size * micro_batch_count;
+}
+
+size_t PipelineTrainer::microBatchRows(size_t k) const {
+    return std::min(micro_batch_size, step_rows - k*micro_batch_size);
+}
+
+double* PipelineTrainer::delta(size_t l, size_t k) {
+    return deltas[l].size() > 1 ? deltas[l][k].data() : deltas[l][0].data();
+}
+
+void PipelineTrainer::stageLoop(size_t s) {
+    size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            start_cv.wait(lock, [this, seen] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        runStage(s);
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            ++finished_stages;
+        }
+        done_cv.notify_one();
+    }
+}
+
+void PipelineTrainer::runStage(size_t s) {
+    auto& layers = net.getLayers();
+    Stage& stage = stages[s];
+    bool first_stage = s == 0, last_stage = s + 1 == stages.size();
+    size_t input_size = net.getInputSize();
+    auto inputOf = [&](size_t l, size_t k) -> const double* {
+        return l == 0 ? X.data() + k*micro_batch_size*input_size : activations[l-1][k].data();
+    };
+
+    // forward wavefront: micro-batch k goes on to the next stage as soon as this one is done with it
+    for (size_t k=0; k<step_micro_batches; ++k) {
+        if (!first_stage) stage.forward_ready->pop();
+        for (size_t l=stage.first_layer; l<stage.end_layer; ++l) {
+            size_t input_n = l == 0 ? input_size : layers[l-1].getNeuronCount();
+            layers[l].forwardBatch(inputOf(l, k), input_n, microBatchRows(k), activations[l][k].data());
+        }
+        if (!last_stage) stages[s+1].forward_ready->push(k);
+    }
+
+    // backward, in the order the last stage starts the micro-batches (latest first, its activations are warmest)
+    for (size_t l=stage.first_layer; l<stage.end_layer; ++l) {
+        std::fill(weight_gradients[l].begin(), weight_gradients[l].end(), 0.0);
+        std::fill(bias_gradients[l].begin(), bias_gradients[l].end(), 0.0);
+    }
+    double loss = 0;
+    for (size_t i=0; i<step_micro_batches; ++i) {
+        size_t k = last_stage ? step_micro_batches - 1 - i : stage.backward_ready->pop();
+        size_t rows = microBatchRows(k);
+        if (last_stage) {
+            size_t out_l = layers.size() - 1, out_n = layers[out_l].getNeuronCount();
+            const double* output = activations[out_l][k].data();
+            const double* y = Y.data() + k*micro_batch_size*out_n;
+            for (size_t b=0; b<rows; ++b) {
+                loss += loss_compute(loss_fxn, output + b*out_n, y + b*out_n, out_n);
+            }
+            layers[out_l].lastLayerDeltaBatch(output, y, rows, loss_fxn, delta(out_l, k));
+        }
+        // the kernels average over the micro-batch, the step averages over all of its rows
+        double weight = static_cast<double>(rows) / static_cast<double>(step_rows);
+        for (size_t l=stage.end_layer; l-- > stage.first_layer;) {
+            size_t input_n = l == 0 ? input_size : layers[l-1].getNeuronCount();
+            layers[l].weightGradientBatch(delta(l, k), inputOf(l, k), input_n, rows,
+                                          stage.weight_gradient.data(), stage.bias_gradient.data());
+            for (size_t j=0; j<weight_gradients[l].size(); ++j) weight_gradients[l][j] += weight * stage.weight_gradient[j];
+            for (size_t j=0; j<bias_gradients[l].size(); ++j) bias_gradients[l][j] += weight * stage.bias_gradient[j];
+            if (l > 0) { // weights aren't updated before all micro-batches are through
+                layers[l].propagateDeltaBatch(delta(l, k), rows, delta(l-1, k));
+                layers[l-1].activationDerivativeBatch(activations[l-1][k].data(), rows, delta(l-1, k));
+            }
+        }
+        if (!first_stage) stages[s-1].backward_ready->push(k);
+    }
+    if (last_stage) step_loss = loss;
+
+    double eta = net.getLearningRate();
+    for (size_t l=stage.first_layer; l<stage.end_layer; ++l) {
+        layers[l].applyGradients(weight_gradients[l].data(), bias_gradients[l].data(), eta);
+    }
+}
+
+double PipelineTrainer::runStep(size_t rows) {
+    std::unique_lock<std::mutex> lock(mtx);
+    step_rows = rows;
+    step_micro_batches = (rows + micro_batch_size - 1) / micro_batch_size;
+    finished_stages = 0;
+    ++generation;
+    start_cv.notify_all();
+    done_cv.wait(lock, [this] { return finished_stages == stages.size(); });
+    return step_loss;
+}
+
+double PipelineTrainer::step(const double* X_rows, const double* Y_rows, size_t rows) {
+    rows = std::min(rows, getBatchSize());
+    if (rows == 0) return 0;
+    if (net.isInferenceOnly()) {
+        std::cerr << "Error: the network was compacted for inference and can't be trained" << std::endl;
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    size_t input_n = net.getInputSize(), out_n = net.getLayerReadOnly().back().getNeuronCount();
+    std::copy(X_rows, X_rows + rows*input_n, X.begin());
+    std::copy(Y_rows, Y_rows + rows*out_n, Y.begin());
+    return runStep(rows) / static_cast<double>(rows);
+}
+
+void PipelineTrainer::fit(const std::vector<std::vector<double>> &X_train, const std::vector<std::vector<double>> &Y_train, int epoch) {
+    size_t sample_size = X_train.size();
+    size_t input_n = net.getInputSize(), out_n = net.getLayerReadOnly().back().getNeuronCount();
+    bool shaped = sample_size > 0 && Y_train.size() == sample_size;
+    for (size_t i=0; shaped && i<sample_size; ++i) { // every row is copied with its own size into the step's buffers
+        shaped = X_train[i].size() == input_n && Y_train[i].size() == out_n;
+    }
+    if (!shaped) {
+        std::cerr << "Error: training data doesn't match the trainer's input and output sizes" << std::endl;
+        return;
+    }
+    if (net.isInferenceOnly()) {
+        std::cerr << "Error: the network was compacted for inference and can't be trained" << std::endl;
+        return;
+    }
+    size_t batch_size = getBatchSize();
+    sample_indices.resize(sample_size);
+    std::iota(sample_indices.begin(), sample_indices.end(), 0);
+
+    std::mt19937& rng = net.getRng(); // setSeed makes the shuffle reproducible, like fit's
+    for (int _=0; _<epoch; ++_) {
+        for (size_t i=sample_size-1; i>0; --i) { // Fisher-Yates
+            std::swap(sample_indices[i], sample_indices[std::uniform_int_distribution<size_t>(0, i)(rng)]);
+        }
+        double cost = 0;
+        for (size_t start=0; start<sample_size; start+=batch_size) {
+            size_t rows = std::min(batch_size, sample_size - start);
+            for (size_t b=0; b<rows; ++b) {
+                size_t k = sample_indices[start + b];
+                std::copy(X_train[k].begin(), X_train[k].end(), X.begin() + b*input_n);
+                std::copy(Y_train[k].begin(), Y_train[k].end(), Y.begin() + b*out_n);
+            }
+            cost += runStep(rows);
+        }
+        if (net.isVerbose()) std::cout << "Cost is: " << cost / static_cast<double>(sample_size) << std::endl;
+    }
+}
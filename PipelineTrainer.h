@@ -0,0 +1,81 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef PIPELINETRAINER_H
+#define PIPELINETRAINER_H
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "BoundedQueue.h"
+#include "utility.h"
+
+class NeuralNetwork;
+
+// Pipeline-parallel (GPipe) training: the layers are split into contiguous stages of about equal multiply-adds,
+// each owned by one thread. A step's mini-batch is cut into micro-batches that flow forward through the stages
+// as a wavefront and then backward, stage to stage through bounded queues, so all stages are busy once the
+// pipeline has filled even when the batch is too small to split across data-parallel workers. Each stage keeps
+// its micro-batches' activations for backward and sums their gradients, and updates its layers once all of them
+// are through, so a step computes the same update as one BatchedTrainer step on the whole mini-batch.
+// The stage threads live as long as the trainer; don't change the network's shape while it exists.
+class PipelineTrainer {
+    struct Stage {
+        size_t first_layer, end_layer; // [first_layer, end_layer)
+        std::unique_ptr<BoundedQueue<size_t>> forward_ready; // micro-batch indices whose input is ready
+        std::unique_ptr<BoundedQueue<size_t>> backward_ready; // ... whose delta for the last layer is ready
+        std::vector<double> weight_gradient, bias_gradient; // scratch for one layer and micro-batch
+        std::thread thread;
+    };
+
+    NeuralNetwork& net;
+    size_t micro_batch_size, micro_batch_count;
+    LossFxn loss_fxn;
+    std::vector<Stage> stages;
+
+    // per layer: the micro-batches' outputs, the working delta, the summed gradients. a layer that ends
+    // a stage gets a delta per micro-batch, since the previous stage reads it while this one goes on
+    std::vector<std::vector<std::vector<double>>> activations;
+    std::vector<std::vector<std::vector<double>>> deltas;
+    std::vector<std::vector<double>> weight_gradients, bias_gradients;
+    std::vector<double> X, Y; // the step's samples, micro-batch after micro-batch
+    std::vector<size_t> sample_indices;
+
+    // current step, written before the stages are started
+    size_t step_rows = 0, step_micro_batches = 0;
+    double step_loss = 0;
+
+    std::mutex mtx;
+    std::condition_variable start_cv, done_cv;
+    size_t generation = 0, finished_stages = 0;
+    bool stopping = false;
+
+    size_t microBatchRows(size_t k) const;
+    double* delta(size_t l, size_t k);
+    void stageLoop(size_t s);
+    void runStage(size_t s);
+    double runStep(size_t rows); // on the rows already in X/Y, returns the summed loss
+
+public:
+    // stage_count is capped at the layer count; a step trains on up to micro_batch_size * micro_batch_count
+    // samples. resizes the first layer like fit when the network isn't shaped for input_size yet
+    PipelineTrainer(NeuralNetwork&, unsigned int input_size, size_t stage_count, size_t micro_batch_size,
+                    size_t micro_batch_count, LossFxn = MSE, size_t queue_capacity = 2);
+    ~PipelineTrainer();
+    PipelineTrainer(const PipelineTrainer&) = delete;
+    PipelineTrainer& operator=(const PipelineTrainer&) = delete;
+
+    std::vector<std::pair<size_t, size_t>> getStages() const; // [first, end) layer of each stage
+    size_t getBatchSize() const;
+    // one step on rows <= batch size samples (row-major X and Y), returns their mean loss before the update
+    double step(const double* X, const double* Y, size_t rows);
+    // one shuffled pass of batch size steps per epoch (with the network's rng), prints the running cost like the
+    // streaming fit when the network is verbose
+    void fit(const std::vector<std::vector<double>> &X_train, const std::vector<std::vector<double>> &Y_train, int epoch);
+};
+
+#endif //PIPELINETRAINER_H
@@ -0,0 +1,80 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#include "Pruning.h"
+#include "NeuralNetwork.h"
+#include <algorithm>
+#include <cmath>
+
+bool PruningSchedule::prunesAt(int epoch) const {
+    if (target_sparsity <= 0 || epoch < begin_epoch || epoch > end_epoch) return false;
+    return epoch == end_epoch || (epoch - begin_epoch) % std::max(frequency, 1) == 0;
+}
+
+double PruningSchedule::sparsityAt(int epoch) const {
+    if (epoch >= end_epoch) return target_sparsity;
+    double t = static_cast<double>(epoch - begin_epoch) / (end_epoch - begin_epoch);
+    t = std::min(std::max(t, 0.0), 1.0);
+    return target_sparsity * (1 - std::pow(1 - t, 3));
+}
+
+namespace {
+    // magnitude below which weights are pruned so that `count` of `magnitudes` go. ties at the threshold are
+    // pruned too, so the result can be slightly sparser than asked
+    double pruningThreshold(std::vector<double>& magnitudes, size_t count) {
+        if (count == 0) return -1;
+        count = std::min(count, magnitudes.size());
+        std::nth_element(magnitudes.begin(), magnitudes.begin() + (count - 1), magnitudes.end());
+        return magnitudes[count - 1];
+    }
+
+    void applyThreshold(Layer& layer, double threshold, double sparse_kernel_threshold) {
+        auto& neurons = layer.getNeurons();
+        size_t input_n = layer.getInputCount();
+        std::vector<uint8_t> mask = layer.getWeightMask();
+        mask.resize(neurons.size() * input_n, 1);
+        for (size_t i=0; i<neurons.size(); ++i) {
+            for (size_t j=0; j<input_n; ++j) {
+                if (std::abs(neurons[i].weights[j]) <= threshold) mask[i*input_n + j] = 0;
+            }
+        }
+        layer.setWeightMask(std::move(mask));
+        layer.setSparseKernels(layer.sparsity() >= sparse_kernel_threshold);
+    }
+}
+
+void pruneByMagnitude(std::vector<Layer>& layers, double sparsity, PruningScope scope, double sparse_kernel_threshold) {
+    for (const auto& layer : layers) {
+        if (layer.isInferenceOnly()) {
+            std::cerr << "Error: the network was compacted for inference and can't be pruned" << std::endl;
+            return;
+        }
+    }
+    sparsity = std::min(std::max(sparsity, 0.0), 1.0);
+    std::vector<double> magnitudes;
+    if (scope == GlobalSparsity) {
+        for (const auto& layer : layers) {
+            for (const auto& neuron : layer.getNeuronsReadOnly()) {
+                for (double w : neuron.weights) magnitudes.push_back(std::abs(w));
+            }
+        }
+        double threshold = pruningThreshold(magnitudes, static_cast<size_t>(sparsity * magnitudes.size()));
+        for (auto& layer : layers) {
+            applyThreshold(layer, threshold, sparse_kernel_threshold);
+        }
+        return;
+    }
+    for (auto& layer : layers) {
+        magnitudes.clear();
+        for (const auto& neuron : layer.getNeuronsReadOnly()) {
+            for (double w : neuron.weights) magnitudes.push_back(std::abs(w));
+        }
+        double threshold = pruningThreshold(magnitudes, static_cast<size_t>(sparsity * magnitudes.size()));
+        applyThreshold(layer, threshold, sparse_kernel_threshold);
+    }
+}
+
+void pruneByMagnitude(NeuralNetwork& net, double sparsity, PruningScope scope, double sparse_kernel_threshold) {
+    pruneByMagnitude(net.getLayers(), sparsity, scope, sparse_kernel_threshold);
+}
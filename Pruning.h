@@ -0,0 +1,39 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef PRUNING_H
+#define PRUNING_H
+
+#include <vector>
+#include "Layer.h"
+
+class NeuralNetwork;
+
+enum PruningScope {
+    PerLayerSparsity, // every layer loses the same fraction of its weights
+    GlobalSparsity, // one magnitude threshold over all weights, wide layers end up sparser than narrow ones
+};
+
+// Gradual magnitude pruning during fit: from begin_epoch to end_epoch the sparsity grows as
+// target * (1 - (1 - t)^3), fast at first while the network can still recover, then levelling off.
+struct PruningSchedule {
+    double target_sparsity = 0; // 0 turns pruning off
+    PruningScope scope = PerLayerSparsity;
+    int begin_epoch = 0;
+    int end_epoch = 0;
+    int frequency = 1; // epochs between pruning steps
+    double sparse_kernel_threshold = 0.7; // layers at least this sparse switch to the CSR kernels
+
+    bool prunesAt(int epoch) const;
+    double sparsityAt(int epoch) const;
+};
+
+// Zeroes the smallest-magnitude weights until `sparsity` of them are zero (per layer or over all layers) and masks
+// them so training can't regrow them. Already pruned weights stay pruned. Layers that end up at least
+// sparse_kernel_threshold sparse switch to CSR forward/backward kernels.
+void pruneByMagnitude(std::vector<Layer>& layers, double sparsity, PruningScope = PerLayerSparsity,
+                      double sparse_kernel_threshold = 0.7);
+void pruneByMagnitude(NeuralNetwork&, double sparsity, PruningScope = PerLayerSparsity, double sparse_kernel_threshold = 0.7);
+
+#endif //PRUNING_H
@@ -0,0 +1,152 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#include "QuantizedNetwork.h"
+#include "NeuralNetwork.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const float int8_max = 127.0f; // symmetric range [-127, 127], -128 unused
+
+    int8_t quantizeValue(double value, float scale) {
+        long q = std::lround(value / scale);
+        return static_cast<int8_t>(std::min(127L, std::max(-127L, q)));
+    }
+
+    // int8 x int8 products summed in int32: at most input_n * 127^2, no overflow below ~133k inputs
+    int32_t dotInt8(const int8_t* a, const int8_t* b, size_t n) {
+        int32_t acc = 0;
+        for (size_t j=0; j<n; ++j) {
+            acc += static_cast<int32_t>(a[j]) * static_cast<int32_t>(b[j]);
+        }
+        return acc;
+    }
+
+    double activate(ActivationType activation, double z) {
+        switch (activation) {
+            case SIGMOID: return sigmoid(z);
+            case RELU: return relu(z);
+            case TANH: return std::tanh(z);
+            default: return z; // LINEAR; SOFTMAX is applied over the whole row
+        }
+    }
+}
+
+QuantizedNetwork QuantizedNetwork::quantize(const NeuralNetwork& net, const std::vector<std::vector<double>>& calibration_samples,
+                                            QuantizationGranularity granularity) {
+    QuantizedNetwork quantized;
+    if (net.isInferenceOnly()) {
+        std::cerr << "Error: the network was compacted for inference, quantize it before" << std::endl;
+        return quantized;
+    }
+    if (calibration_samples.empty()) {
+        std::cerr << "Error: quantize needs at least one calibration sample" << std::endl;
+        return quantized;
+    }
+    for (const auto& sample : calibration_samples) {
+        if (sample.size() != net.getInputSize()) {
+            std::cerr << "Error: calibration sample size doesn't match with the network's input size" << std::endl;
+            return quantized;
+        }
+    }
+    quantized.input_size = net.getInputSize();
+    const auto& float_layers = net.getLayerReadOnly();
+
+    // calibration: run the samples through the float model layer by layer and record each layer's input range
+    size_t batch = calibration_samples.size();
+    std::vector<double> activations;
+    activations.reserve(batch * quantized.input_size);
+    for (const auto& sample : calibration_samples) {
+        activations.insert(activations.end(), sample.begin(), sample.end());
+    }
+    unsigned long input_n = quantized.input_size;
+
+    for (const auto& layer : float_layers) {
+        QuantizedLayer q;
+        q.input_n = input_n;
+        q.output_n = layer.getNeuronCount();
+        q.activation = layer.getActivationType();
+
+        double max_input = 0;
+        for (double a : activations) max_input = std::max(max_input, std::abs(a));
+        q.input_scale = max_input > 0 ? static_cast<float>(max_input / int8_max) : 1.0f;
+
+        const auto& neurons = layer.getNeuronsReadOnly();
+        double layer_max = 0;
+        for (const auto& neuron : neurons) {
+            for (double w : neuron.weights) layer_max = std::max(layer_max, std::abs(w));
+        }
+        q.weights.resize(q.output_n * q.input_n);
+        q.weight_scales.resize(q.output_n);
+        q.bias.resize(q.output_n);
+        for (size_t i=0; i<q.output_n; ++i) {
+            double row_max = layer_max;
+            if (granularity == PerRow) {
+                row_max = 0;
+                for (double w : neurons[i].weights) row_max = std::max(row_max, std::abs(w));
+            }
+            float scale = row_max > 0 ? static_cast<float>(row_max / int8_max) : 1.0f;
+            q.weight_scales[i] = scale;
+            q.bias[i] = static_cast<float>(neurons[i].bias);
+            for (size_t j=0; j<q.input_n; ++j) {
+                q.weights[i*q.input_n + j] = quantizeValue(neurons[i].weights[j], scale);
+            }
+        }
+
+        std::vector<double> next(batch * q.output_n);
+        if (batch > 0) layer.forwardBatch(activations.data(), input_n, batch, next.data());
+        activations = std::move(next);
+        input_n = q.output_n;
+        quantized.layers.push_back(std::move(q));
+    }
+    return quantized;
+}
+
+unsigned int QuantizedNetwork::getInputSize() const {
+    return input_size;
+}
+
+size_t QuantizedNetwork::weightBytes() const {
+    size_t bytes = 0;
+    for (const auto& layer : layers) {
+        bytes += layer.weights.size() * sizeof(int8_t) + (layer.weight_scales.size() + layer.bias.size() + 1) * sizeof(float);
+    }
+    return bytes;
+}
+
+std::vector<double> QuantizedNetwork::predict(const std::vector<double>& input_vector) const {
+    if (input_vector.size() != input_size) {
+        std::cerr << "Error: input vector size doesn't match with quantized network's input size" << std::endl;
+        return {};
+    }
+    std::vector<double> values = input_vector;
+    std::vector<int8_t> quantized_input;
+    for (const auto& layer : layers) {
+        quantized_input.resize(layer.input_n);
+        for (size_t j=0; j<layer.input_n; ++j) {
+            quantized_input[j] = quantizeValue(values[j], layer.input_scale);
+        }
+        values.resize(layer.output_n);
+        for (size_t i=0; i<layer.output_n; ++i) {
+            int32_t acc = dotInt8(&layer.weights[i*layer.input_n], quantized_input.data(), layer.input_n);
+            double z = acc * static_cast<double>(layer.weight_scales[i]) * layer.input_scale + layer.bias[i]; // dequantize
+            values[i] = activate(layer.activation, z);
+        }
+        if (layer.activation == SOFTMAX) {
+            std::vector<double> logits = values;
+            softmax(logits, values);
+        }
+    }
+    return values;
+}
+
+std::vector<std::vector<double>> QuantizedNetwork::predict(const std::vector<std::vector<double>>& input_vectors) const {
+    std::vector<std::vector<double>> predictions;
+    predictions.reserve(input_vectors.size());
+    for (const auto& input_vector : input_vectors) {
+        predictions.push_back(predict(input_vector));
+    }
+    return predictions;
+}
@@ -0,0 +1,52 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef QUANTIZEDNETWORK_H
+#define QUANTIZEDNETWORK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "utility.h"
+
+class NeuralNetwork;
+
+enum QuantizationGranularity {
+    PerLayer, // one weight scale for the whole layer
+    PerRow, // one weight scale per neuron, more accurate for rows of very different magnitude
+};
+
+// Int8 post-training quantized copy of a trained NeuralNetwork, for inference only.
+// Weights are quantized symmetrically to int8, every layer's input is quantized with a scale calibrated on sample
+// data, dot products accumulate in int32, and the result is dequantized (z = acc * w_scale * in_scale + bias)
+// before the activation, which runs in float.
+class QuantizedNetwork {
+    struct QuantizedLayer {
+        unsigned long input_n;
+        unsigned long output_n;
+        ActivationType activation;
+        std::vector<int8_t> weights; // output_n x input_n, row-major
+        std::vector<float> weight_scales; // per row (all equal for PerLayer)
+        std::vector<float> bias;
+        float input_scale; // real value of one input step
+    };
+
+    std::vector<QuantizedLayer> layers;
+    unsigned int input_size;
+
+public:
+    QuantizedNetwork() : input_size(0) {}
+
+    // calibration_samples should look like production inputs, their range decides every layer's input scale. an empty
+    // set or a row of the wrong size is refused with an empty network
+    static QuantizedNetwork quantize(const NeuralNetwork&, const std::vector<std::vector<double>>& calibration_samples,
+                                     QuantizationGranularity = PerRow);
+
+    unsigned int getInputSize() const;
+    size_t weightBytes() const; // int8 weights + float scales and biases
+    std::vector<double> predict(const std::vector<double>&) const;
+    std::vector<std::vector<double>> predict(const std::vector<std::vector<double>>&) const;
+};
+
+#endif //QUANTIZEDNETWORK_H
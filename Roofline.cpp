@@ -0,0 +1,81 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#include "Roofline.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double secondsSince(const Clock::time_point& start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    const char* phaseName(TrainingPhase phase) {
+        switch (phase) {
+            case ForwardPass: return "forward";
+            case BackwardPass: return "backward";
+            case WeightUpdate: return "update";
+            default: return "?";
+        }
+    }
+}
+
+MachinePeak measureMachinePeak() {
+    MachinePeak peak{0, 0};
+
+    // compute peak: independent multiply-add chains that stay in registers / L1
+    const int lanes = 32;
+    const long iterations = 4000000;
+    std::vector<double> acc(lanes, 1.0);
+    const double mul = 0.999999, add = 1e-6;
+    for (int r=0; r<3; ++r) {
+        auto start = Clock::now();
+        for (long it=0; it<iterations; ++it) {
+            for (int k=0; k<lanes; ++k) {
+                acc[k] = acc[k] * mul + add;
+            }
+        }
+        double seconds = secondsSince(start);
+        peak.gflops = std::max(peak.gflops, 2.0 * lanes * iterations / seconds * 1e-9);
+    }
+    volatile double sink = acc[0]; // keep the loop alive
+    (void)sink;
+
+    // bandwidth peak: stream triad over arrays well beyond the last level cache
+    const size_t n = 1 << 22; // 32MB per array
+    std::vector<double> a(n, 0.0), b(n, 1.0), c(n, 2.0);
+    for (int r=0; r<5; ++r) {
+        auto start = Clock::now();
+        for (size_t i=0; i<n; ++i) {
+            a[i] = b[i] + 0.5 * c[i];
+        }
+        double seconds = secondsSince(start);
+        peak.gbytes_per_sec = std::max(peak.gbytes_per_sec, 3.0 * sizeof(double) * n / seconds * 1e-9);
+    }
+    sink = a[n/2];
+    return peak;
+}
+
+void printRooflineReport(const std::vector<LayerProfile>& profiles, const MachinePeak& peak) {
+    double ridge = peak.gflops / peak.gbytes_per_sec; // flop/byte where the roofline turns flat
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Machine peak: " << peak.gflops << " GFLOP/s, " << peak.gbytes_per_sec << " GB/s (ridge at "
+              << ridge << " flop/byte)" << std::endl;
+    std::cout << std::left << std::setw(7) << "layer" << std::setw(10) << "phase" << std::right
+              << std::setw(12) << "MFLOP" << std::setw(12) << "MB" << std::setw(10) << "flop/B"
+              << std::setw(10) << "GFLOP/s" << std::setw(10) << "GB/s" << std::setw(12) << "% of roof" << "  bound" << std::endl;
+    for (const auto& profile : profiles) {
+        double roof = std::min(peak.gflops, profile.intensity() * peak.gbytes_per_sec);
+        std::cout << std::left << std::setw(7) << profile.layer << std::setw(10) << phaseName(profile.phase) << std::right
+                  << std::setw(12) << profile.flops * 1e-6 << std::setw(12) << profile.bytes * 1e-6
+                  << std::setw(10) << profile.intensity() << std::setw(10) << profile.gflops()
+                  << std::setw(10) << profile.gbytesPerSec() << std::setw(11) << (roof > 0 ? profile.gflops() / roof * 100 : 0) << "%"
+                  << "  " << (profile.intensity() < ridge ? "memory" : "compute") << std::endl;
+    }
+    std::cout << std::defaultfloat;
+}
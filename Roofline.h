@@ -0,0 +1,31 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef ROOFLINE_H
+#define ROOFLINE_H
+
+#include <vector>
+#include "utility.h"
+
+struct MachinePeak {
+    double gflops; // double precision multiply-add throughput of a single core
+    double gbytes_per_sec; // streaming (triad) memory bandwidth
+};
+
+struct LayerProfile {
+    unsigned long layer;
+    TrainingPhase phase;
+    double flops; // totals over every profiled sample
+    double bytes;
+    double seconds;
+
+    double gflops() const { return seconds > 0 ? flops / seconds * 1e-9 : 0; }
+    double gbytesPerSec() const { return seconds > 0 ? bytes / seconds * 1e-9 : 0; }
+    double intensity() const { return bytes > 0 ? flops / bytes : 0; } // flop per byte
+};
+
+MachinePeak measureMachinePeak();
+void printRooflineReport(const std::vector<LayerProfile>&, const MachinePeak&);
+
+#endif //ROOFLINE_H
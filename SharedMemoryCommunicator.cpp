@@ -0,0 +1,215 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#include "SharedMemoryCommunicator.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+// the atomics are used from several processes, which is only sound when they're lock-free (address-free)
+static_assert(std::atomic<unsigned long long>::is_always_lock_free, "shared memory counters must be lock-free");
+
+struct ShmHeader {
+    std::atomic<uint64_t> magic; // written last by rank 0, once the segment is set up
+    std::atomic<uint32_t> attached;
+    uint32_t world_size;
+    uint64_t slot_doubles;
+};
+
+struct ShmRankState {
+    alignas(64) std::atomic<unsigned long long> sent; // messages written to this rank's slot
+    alignas(64) std::atomic<unsigned long long> consumed; // ... of those, read by the right neighbour
+};
+
+namespace {
+    const uint64_t segment_magic = 0x4e4e52494e473031; // "NNRING01"
+
+    size_t alignUp(size_t value) {
+        return (value + 63) / 64 * 64;
+    }
+
+    double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+SharedMemoryCommunicator::SharedMemoryCommunicator(const std::string& name, size_t _rank, size_t _size,
+                                                   size_t _slot_doubles, double _timeout_seconds)
+    : rank_id(_rank), world_size(_size), slot_doubles(std::max<size_t>(_slot_doubles, 1)),
+      timeout_seconds(_timeout_seconds) {
+    if (world_size == 0 || rank_id >= world_size) {
+        std::cerr << "Error: rank " << rank_id << " out of range for " << world_size << " ranks" << std::endl;
+        return;
+    }
+    if (world_size == 1) return; // nothing to exchange
+
+    size_t states_offset = alignUp(sizeof(ShmHeader));
+    size_t slots_offset = states_offset + alignUp(world_size * sizeof(ShmRankState));
+    mapping_size = slots_offset + world_size * slot_doubles * sizeof(double);
+    auto start = std::chrono::steady_clock::now();
+
+    int fd = -1;
+    if (rank_id == 0) {
+        shm_unlink(name.c_str()); // a leftover from a run that died while starting up
+        fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0 || ftruncate(fd, static_cast<off_t>(mapping_size)) != 0) {
+            std::cerr << "Cannot create shared memory segment: " << name << std::endl;
+            if (fd >= 0) close(fd);
+            shm_unlink(name.c_str());
+            return;
+        }
+    }
+    else { // wait for rank 0 to create and size it
+        struct stat st{};
+        while ((fd = shm_open(name.c_str(), O_RDWR, 0600)) < 0 || fstat(fd, &st) != 0
+               || st.st_size != static_cast<off_t>(mapping_size)) {
+            if (fd >= 0) close(fd);
+            if (secondsSince(start) > timeout_seconds) {
+                std::cerr << "Timed out waiting for shared memory segment: " << name << std::endl;
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    void* ptr = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the segment alive
+    if (ptr == MAP_FAILED) {
+        std::cerr << "Cannot map shared memory segment: " << name << std::endl;
+        if (rank_id == 0) shm_unlink(name.c_str());
+        return;
+    }
+    mapping = ptr;
+    auto* base = static_cast<unsigned char*>(ptr);
+
+    if (rank_id == 0) {
+        header = new (base) ShmHeader();
+        header->attached.store(1);
+        header->world_size = static_cast<uint32_t>(world_size);
+        header->slot_doubles = slot_doubles;
+        states = reinterpret_cast<ShmRankState*>(base + states_offset);
+        for (size_t r=0; r<world_size; ++r) {
+            new (&states[r]) ShmRankState();
+            states[r].sent.store(0);
+            states[r].consumed.store(0);
+        }
+        header->magic.store(segment_magic, std::memory_order_release);
+        while (header->attached.load(std::memory_order_acquire) < world_size) {
+            if (secondsSince(start) > timeout_seconds) {
+                std::cerr << "Timed out waiting for " << world_size - header->attached.load() << " ranks to attach" << std::endl;
+                shm_unlink(name.c_str());
+                header = nullptr;
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        shm_unlink(name.c_str()); // everyone has it mapped, the name isn't needed anymore
+    }
+    else {
+        header = reinterpret_cast<ShmHeader*>(base);
+        while (header->magic.load(std::memory_order_acquire) != segment_magic) {
+            if (secondsSince(start) > timeout_seconds) {
+                std::cerr << "Timed out waiting for rank 0 to set up: " << name << std::endl;
+                header = nullptr;
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (header->world_size != world_size || header->slot_doubles != slot_doubles) {
+            std::cerr << "Error: ranks disagree on the size of " << name << std::endl;
+            header = nullptr;
+            return;
+        }
+        states = reinterpret_cast<ShmRankState*>(base + states_offset);
+        header->attached.fetch_add(1, std::memory_order_acq_rel);
+    }
+    slots = reinterpret_cast<double*>(base + slots_offset);
+}
+
+SharedMemoryCommunicator::~SharedMemoryCommunicator() {
+    if (mapping) munmap(mapping, mapping_size);
+}
+
+bool SharedMemoryCommunicator::isConnected() const {
+    return rank_id < world_size && (world_size == 1 || header != nullptr);
+}
+
+size_t SharedMemoryCommunicator::rank() const {
+    return rank_id;
+}
+
+size_t SharedMemoryCommunicator::size() const {
+    return world_size;
+}
+
+bool SharedMemoryCommunicator::waitFor(const std::atomic<unsigned long long>& target, unsigned long long value) const {
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long spins=0; target.load(std::memory_order_acquire) < value; ++spins) {
+        if (spins < 1024) continue; // the neighbour is usually a few microseconds away
+        std::this_thread::yield();
+        if (spins % 1024 == 0 && secondsSince(start) > timeout_seconds) {
+            std::cerr << "Error: all-reduce timed out, a rank stopped responding" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SharedMemoryCommunicator::send(const double* values, size_t count) {
+    ShmRankState& own = states[rank_id];
+    if (!waitFor(own.consumed, messages)) return false; // the right neighbour has read the previous message
+    std::memcpy(slots + rank_id*slot_doubles, values, count * sizeof(double));
+    own.sent.store(++messages, std::memory_order_release);
+    return true;
+}
+
+bool SharedMemoryCommunicator::receive(double* values, size_t count, bool add) {
+    size_t left = (rank_id + world_size - 1) % world_size;
+    ShmRankState& from = states[left];
+    if (!waitFor(from.sent, messages)) return false; // every rank sends the same sequence, left's is ours
+    const double* slot = slots + left*slot_doubles;
+    if (add) {
+        for (size_t k=0; k<count; ++k) values[k] += slot[k];
+    }
+    else {
+        std::memcpy(values, slot, count * sizeof(double));
+    }
+    from.consumed.store(messages, std::memory_order_release);
+    return true;
+}
+
+bool SharedMemoryCommunicator::allReduce(double* values, size_t count) {
+    if (!isConnected()) return false;
+    if (world_size == 1) return true;
+    size_t N = world_size;
+    // a chunk per rank has to fit in a slot, so longer arrays go piece by piece
+    for (size_t offset=0; offset<count; offset+=N*slot_doubles) {
+        double* piece = values + offset;
+        size_t n = std::min(N*slot_doubles, count - offset);
+        auto chunkBegin = [n, N](size_t c) { return c * n / N; };
+        auto chunk = [&](size_t step_back) { return (rank_id + N - step_back % N) % N; };
+        // reduce-scatter: pass on the partial chunk just received (own values added), after N-1 steps
+        // chunk rank+1 holds every rank's values
+        for (size_t s=0; s+1<N; ++s) {
+            size_t out = chunk(s), in = chunk(s + 1);
+            if (!send(piece + chunkBegin(out), chunkBegin(out + 1) - chunkBegin(out))) return false;
+            if (!receive(piece + chunkBegin(in), chunkBegin(in + 1) - chunkBegin(in), true)) return false;
+        }
+        // all-gather: the finished chunks go once around the ring
+        for (size_t s=0; s+1<N; ++s) {
+            size_t out = (rank_id + 1 + N - s) % N, in = chunk(s);
+            if (!send(piece + chunkBegin(out), chunkBegin(out + 1) - chunkBegin(out))) return false;
+            if (!receive(piece + chunkBegin(in), chunkBegin(in + 1) - chunkBegin(in), false)) return false;
+        }
+    }
+    return true;
+}
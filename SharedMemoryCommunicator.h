@@ -0,0 +1,54 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef SHAREDMEMORYCOMMUNICATOR_H
+#define SHAREDMEMORYCOMMUNICATOR_H
+
+#include <atomic>
+#include <string>
+#include "Communicator.h"
+
+struct ShmHeader;
+struct ShmRankState;
+
+// Communicator between processes on one machine through a POSIX shared memory segment. allReduce is a ring
+// all-reduce: the values are cut into one chunk per rank, N-1 reduce-scatter steps each add the left
+// neighbour's partial chunk into our own, and N-1 all-gather steps pass the finished chunks around. Every
+// rank sends and receives (N-1)/N of the values twice, however many ranks there are. Messages go through one
+// slot per rank that only its right neighbour reads, with a sent / consumed counter pair as the handshake.
+//
+// Start one process per rank with the same name and size (e.g. "/nn-train-<launcher pid>"; at most 31 chars on
+// macOS). Rank 0 creates the segment and unlinks the name once every rank has attached, so nothing is left
+// behind after the run.
+class SharedMemoryCommunicator : public Communicator {
+    size_t rank_id, world_size;
+    size_t slot_doubles; // values per message
+    double timeout_seconds;
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+    ShmHeader* header = nullptr;
+    ShmRankState* states = nullptr;
+    double* slots = nullptr;
+    unsigned long long messages = 0; // sent by this rank so far, the same sequence on every rank
+
+    bool send(const double* values, size_t count);
+    bool receive(double* values, size_t count, bool add);
+    bool waitFor(const std::atomic<unsigned long long>& counter, unsigned long long value) const;
+
+public:
+    // blocks until all ranks have attached (or the timeout passed, then isConnected is false).
+    // slot_doubles bounds one message, longer all-reduces are done in pieces
+    SharedMemoryCommunicator(const std::string& name, size_t rank, size_t size, size_t slot_doubles = 1 << 16,
+                             double timeout_seconds = 60);
+    ~SharedMemoryCommunicator() override;
+    SharedMemoryCommunicator(const SharedMemoryCommunicator&) = delete;
+    SharedMemoryCommunicator& operator=(const SharedMemoryCommunicator&) = delete;
+
+    bool isConnected() const;
+    size_t rank() const override;
+    size_t size() const override;
+    bool allReduce(double* values, size_t count) override;
+};
+
+#endif //SHAREDMEMORYCOMMUNICATOR_H
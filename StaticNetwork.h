@@ -0,0 +1,164 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef STATICNETWORK_H
+#define STATICNETWORK_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include "NeuralNetwork.h"
+#include "utility.h"
+
+// One dense layer of a StaticNetwork: activation and width are template arguments.
+template <ActivationType Activation, size_t Size>
+struct StaticLayer {
+    static constexpr ActivationType activation = Activation;
+    static constexpr size_t size = Size;
+};
+
+namespace static_network_detail {
+    template <size_t InputSize, typename LayerSpec>
+    struct DenseWeights {
+        alignas(64) std::array<double, LayerSpec::size * InputSize> weights{}; // row-major, one row per neuron
+        std::array<double, LayerSpec::size> bias{};
+    };
+
+    template <ActivationType Activation, size_t N>
+    inline void activate(std::array<double, N>& values) {
+        if constexpr (Activation == SOFTMAX) {
+            double max_logit = values[0];
+            for (size_t i=1; i<N; ++i) max_logit = std::max(max_logit, values[i]);
+            double sum = 0;
+            for (auto& value : values) {
+                value = std::exp(value - max_logit);
+                sum += value;
+            }
+            for (auto& value : values) value /= sum;
+        }
+        else if constexpr (Activation == SIGMOID) {
+            for (auto& value : values) value = sigmoid(value);
+        }
+        else if constexpr (Activation == RELU) {
+            for (auto& value : values) value = value > 0 ? value : 0.0;
+        }
+        else if constexpr (Activation == TANH) {
+            for (auto& value : values) value = std::tanh(value);
+        }
+    }
+
+    template <size_t InputSize, typename LayerSpec>
+    inline void forwardLayer(const DenseWeights<InputSize, LayerSpec>& layer, const std::array<double, InputSize>& input,
+                             std::array<double, LayerSpec::size>& output) {
+        // every bound is a constant, so the compiler can unroll these for the exact shape. the dot product is summed
+        // in order like Layer's dense kernel, so results match predict, but that also keeps the reduction from
+        // vectorizing (it would need -ffast-math reassociation)
+        for (size_t i=0; i<LayerSpec::size; ++i) {
+            const double* row = layer.weights.data() + i*InputSize;
+            double z = 0;
+            for (size_t j=0; j<InputSize; ++j) {
+                z += row[j] * input[j];
+            }
+            output[i] = z + layer.bias[i];
+        }
+        activate<LayerSpec::activation>(output);
+    }
+
+    template <size_t InputSize, typename LayerSpec>
+    bool copyLayer(DenseWeights<InputSize, LayerSpec>& target, const Layer& source, size_t index) {
+        if (source.getNeuronCount() != LayerSpec::size || source.getInputCount() != InputSize
+            || source.getActivationType() != LayerSpec::activation) {
+            std::cerr << "Error: layer " << index << " doesn't match the static network's shape or activation" << std::endl;
+            return false;
+        }
+        // the static layers are dense doubles with the exact activations, anything else would predict differently
+        if (source.getWeightPrecision() != FullPrecision || source.getActivationAccuracy() != Exact || source.isInferenceOnly()) {
+            std::cerr << "Error: layer " << index << " uses 16-bit weights or approximate activations, "
+                      << "the static network only runs full precision and exact activations" << std::endl;
+            return false;
+        }
+        if (!source.getWeightMask().empty() || source.usesSparseKernels()) {
+            std::cerr << "Warning: layer " << index << " is pruned, the static network runs it dense" << std::endl;
+        }
+        const auto& neurons = source.getNeuronsReadOnly();
+        for (size_t i=0; i<LayerSpec::size; ++i) {
+            std::copy(neurons[i].weights.begin(), neurons[i].weights.end(), target.weights.begin() + i*InputSize);
+            target.bias[i] = neurons[i].bias;
+        }
+        return true;
+    }
+
+    // the layers as a compile-time list: this layer's weights, then the rest with this layer's width as input
+    template <size_t InputSize, typename First, typename... Rest>
+    struct LayerChain {
+        using Next = LayerChain<First::size, Rest...>;
+        static constexpr size_t output_size = Next::output_size;
+
+        DenseWeights<InputSize, First> layer;
+        Next rest;
+
+        void forward(const std::array<double, InputSize>& input, std::array<double, output_size>& output) const {
+            std::array<double, First::size> hidden; // on the stack, no allocation
+            forwardLayer(layer, input, hidden);
+            rest.forward(hidden, output);
+        }
+
+        bool copyFrom(const std::vector<Layer>& layers, size_t index) {
+            return copyLayer(layer, layers[index], index) && rest.copyFrom(layers, index + 1);
+        }
+    };
+
+    template <size_t InputSize, typename Last>
+    struct LayerChain<InputSize, Last> {
+        static constexpr size_t output_size = Last::size;
+
+        DenseWeights<InputSize, Last> layer;
+
+        void forward(const std::array<double, InputSize>& input, std::array<double, output_size>& output) const {
+            forwardLayer(layer, input, output);
+        }
+
+        bool copyFrom(const std::vector<Layer>& layers, size_t index) {
+            return copyLayer(layer, layers[index], index);
+        }
+    };
+}
+
+// Inference-only copy of a trained NeuralNetwork whose topology is fixed at compile time, e.g.
+//   StaticNetwork<2, StaticLayer<LINEAR, 12>, StaticLayer<LINEAR, 10>, StaticLayer<LINEAR, 5>, StaticLayer<LINEAR, 1>>
+// Weights live inline in std::arrays and activations on the stack, so predict has no indirection or allocation
+// and every loop has constant bounds. Header-only; the shape is checked against the trained network in copyFrom.
+template <size_t InputSize, typename... Layers>
+class StaticNetwork {
+    static_assert(sizeof...(Layers) > 0, "a StaticNetwork needs at least one layer");
+    using Chain = static_network_detail::LayerChain<InputSize, Layers...>;
+
+    Chain chain;
+
+public:
+    static constexpr size_t input_size = InputSize;
+    static constexpr size_t output_size = Chain::output_size;
+    static constexpr size_t layer_count = sizeof...(Layers);
+
+    // false (and the weights left partly copied) if the layer count, a shape or an activation differs, or a layer
+    // uses 16-bit weights or approximate activations. pruned layers are copied dense
+    bool copyFrom(const NeuralNetwork& net) {
+        const auto& layers = net.getLayerReadOnly();
+        if (layers.size() != layer_count || net.getInputSize() != InputSize) {
+            std::cerr << "Error: trained network has " << layers.size() << " layers and input size " << net.getInputSize()
+                      << ", the static network " << layer_count << " and " << InputSize << std::endl;
+            return false;
+        }
+        return chain.copyFrom(layers, 0);
+    }
+
+    std::array<double, output_size> predict(const std::array<double, input_size>& input) const {
+        std::array<double, output_size> output;
+        chain.forward(input, output);
+        return output;
+    }
+};
+
+#endif //STATICNETWORK_H
@@ -0,0 +1,126 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#include "StreamingDataset.h"
+#include <cstdlib>
+#include <iostream>
+
+StreamingDataset::StreamingDataset(const std::string& path, DatasetFormat _format, size_t _feature_count, size_t _label_count,
+                                   size_t _chunk_rows, bool _has_header)
+    : file(path, std::ios::binary), format(_format), feature_count(_feature_count), label_count(_label_count),
+      chunk_rows(std::max<size_t>(_chunk_rows, 1)), has_header(_has_header), front(0), back_ready(false), stopping(false), failed(false)
+{
+    for (auto& chunk : chunks) {
+        chunk.features.resize(chunk_rows * feature_count);
+        chunk.labels.resize(chunk_rows * label_count);
+    }
+    if (!file) {
+        std::cerr << "Cannot open dataset: " << path << std::endl;
+        back_ready = true; // nothing will ever be read, every pass is empty
+        return;
+    }
+    seekToStart();
+    prefetcher = std::thread(&StreamingDataset::prefetchLoop, this);
+}
+
+StreamingDataset::~StreamingDataset() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    cv.notify_all();
+    if (prefetcher.joinable()) prefetcher.join();
+}
+
+bool StreamingDataset::isOpen() const {
+    return file.is_open() && !failed;
+}
+
+size_t StreamingDataset::getFeatureCount() const {
+    return feature_count;
+}
+
+size_t StreamingDataset::getLabelCount() const {
+    return label_count;
+}
+
+const DataChunk* StreamingDataset::nextChunk() {
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [this] { return back_ready; });
+    if (chunks[1-front].rows == 0) return nullptr; // end of the pass, stays "ready" until rewind
+    front = 1-front;
+    back_ready = false; // hand the old front back to the prefetcher
+    lock.unlock();
+    cv.notify_all();
+    return &chunks[front];
+}
+
+void StreamingDataset::rewind() {
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [this] { return back_ready; }); // the prefetcher is idle, the file is ours
+    if (!prefetcher.joinable()) return;
+    seekToStart();
+    back_ready = false;
+    lock.unlock();
+    cv.notify_all();
+}
+
+void StreamingDataset::prefetchLoop() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        cv.wait(lock, [this] { return stopping || !back_ready; });
+        if (stopping) return;
+        DataChunk& back = chunks[1-front];
+        lock.unlock();
+        readChunk(back); // decode without holding the lock, the consumer keeps training on the front chunk
+        lock.lock();
+        back_ready = true;
+        cv.notify_all();
+    }
+}
+
+void StreamingDataset::seekToStart() {
+    file.clear();
+    file.seekg(0);
+    if (format == CSV && has_header) {
+        std::string header;
+        std::getline(file, header);
+    }
+}
+
+void StreamingDataset::readChunk(DataChunk& chunk) {
+    chunk.rows = 0;
+    if (failed) return;
+
+    if (format == RawBinary) {
+        while (chunk.rows < chunk_rows) {
+            file.read(reinterpret_cast<char*>(&chunk.features[chunk.rows * feature_count]), feature_count * sizeof(double));
+            file.read(reinterpret_cast<char*>(&chunk.labels[chunk.rows * label_count]), label_count * sizeof(double));
+            if (!file) break; // a partial trailing row is dropped
+            ++chunk.rows;
+        }
+        return;
+    }
+
+    std::string line; // reuses its capacity from the previous line
+    while (chunk.rows < chunk_rows && std::getline(file, line)) {
+        if (line.empty() || line == "\r") continue;
+        const char* pos = line.c_str();
+        double* features = &chunk.features[chunk.rows * feature_count];
+        double* labels = &chunk.labels[chunk.rows * label_count];
+        for (size_t k=0; k<feature_count+label_count; ++k) {
+            char* end;
+            double value = std::strtod(pos, &end);
+            if (end == pos) {
+                std::cerr << "Malformed dataset line (expected " << feature_count + label_count << " values): " << line << std::endl;
+                failed = true;
+                return;
+            }
+            (k < feature_count ? features[k] : labels[k - feature_count]) = value;
+            pos = end;
+            while (*pos == ',' || *pos == ' ' || *pos == '\t') ++pos;
+        }
+        ++chunk.rows;
+    }
+}
@@ -0,0 +1,68 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef STREAMINGDATASET_H
+#define STREAMINGDATASET_H
+
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum DatasetFormat {
+    CSV, // one sample per line: features then labels, comma separated
+    RawBinary, // float64 rows of features then labels, no header
+};
+
+struct DataChunk {
+    std::vector<double> features; // rows x feature_count, row-major and contiguous
+    std::vector<double> labels; // rows x label_count
+    size_t rows = 0;
+};
+
+// Reads a dataset from disk in chunks of chunk_rows samples. A background thread decodes the next chunk
+// into the back buffer while the caller trains on the front one, so only two chunks are ever in memory.
+// The prefetcher is a dedicated thread, not a ThreadPool task: a training thread waiting in a parallel loop
+// would run the queued read inline, and with one pool thread nothing would overlap.
+class StreamingDataset {
+    std::ifstream file;
+    DatasetFormat format;
+    size_t feature_count;
+    size_t label_count;
+    size_t chunk_rows;
+    bool has_header; // CSV only, first line is skipped
+
+    DataChunk chunks[2];
+    int front; // index of the chunk handed out by nextChunk
+    bool back_ready; // the prefetcher filled chunks[1-front] (rows == 0 at the end of the file)
+    bool stopping;
+    std::atomic<bool> failed; // a malformed line ends every pass
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::thread prefetcher;
+
+    void prefetchLoop();
+    void readChunk(DataChunk&);
+    void seekToStart();
+
+public:
+    StreamingDataset(const std::string& path, DatasetFormat, size_t feature_count, size_t label_count,
+                     size_t chunk_rows = 4096, bool has_header = false);
+    ~StreamingDataset();
+    StreamingDataset(const StreamingDataset&) = delete;
+    StreamingDataset& operator=(const StreamingDataset&) = delete;
+
+    bool isOpen() const;
+    size_t getFeatureCount() const;
+    size_t getLabelCount() const;
+    // next chunk of the current pass, nullptr when the pass is over. valid until the next call
+    const DataChunk* nextChunk();
+    // starts a new pass from the beginning of the file (next epoch)
+    void rewind();
+};
+
+#endif //STREAMINGDATASET_H
@@ -0,0 +1,361 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#include "TcpCommunicator.h"
+#include "HalfPrecision.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+#ifdef MSG_NOSIGNAL
+    const int send_flags = MSG_NOSIGNAL; // a rank dying must not SIGPIPE the others
+#else
+    const int send_flags = 0;
+#endif
+
+    double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // "host:port", the host may be a name or an address ("[::1]:5000" for IPv6)
+    addrinfo* resolve(const std::string& address, bool passive) {
+        size_t colon = address.rfind(':');
+        if (colon == std::string::npos) {
+            std::cerr << "Address without a port: " << address << std::endl;
+            return nullptr;
+        }
+        std::string host = address.substr(0, colon), port = address.substr(colon + 1);
+        if (host.size() >= 2 && host.front() == '[' && host.back() == ']') host = host.substr(1, host.size() - 2);
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        if (passive) hints.ai_flags = AI_PASSIVE;
+        addrinfo* result = nullptr;
+        int error = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &result);
+        if (error != 0) {
+            std::cerr << "Cannot resolve " << address << ": " << gai_strerror(error) << std::endl;
+            return nullptr;
+        }
+        return result;
+    }
+
+    bool writeAll(int fd, const void* data, size_t size) {
+        auto* ptr = static_cast<const char*>(data);
+        while (size > 0) {
+            ssize_t n = send(fd, ptr, size, send_flags);
+            if (n <= 0) return false;
+            ptr += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    bool readAll(int fd, void* data, size_t size) {
+        auto* ptr = static_cast<char*>(data);
+        while (size > 0) {
+            ssize_t n = recv(fd, ptr, size, 0);
+            if (n <= 0) return false;
+            ptr += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    // small messages go out at once, and exchange() polls instead of blocking
+    void configure(int fd) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef SO_NOSIGPIPE
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+
+    uint16_t toGradientHalf(double value) { // saturate instead of overflowing to inf, which error feedback can't undo
+        return toFloat16(static_cast<float>(std::max(-65504.0, std::min(value, 65504.0))));
+    }
+}
+
+TcpCommunicator::TcpCommunicator(const std::vector<std::string>& addresses, size_t _rank, double _timeout_seconds)
+    : rank_id(_rank), world_size(addresses.size()), timeout_seconds(_timeout_seconds), gathered(addresses.size()) {
+    if (rank_id >= world_size) {
+        std::cerr << "Error: rank " << rank_id << " out of range for " << world_size << " ranks" << std::endl;
+        return;
+    }
+    if (world_size > 1 && !connectRing(addresses)) {
+        if (left_fd >= 0) close(left_fd);
+        if (right_fd >= 0) close(right_fd);
+        left_fd = right_fd = -1;
+    }
+}
+
+TcpCommunicator::~TcpCommunicator() {
+    if (left_fd >= 0) close(left_fd);
+    if (right_fd >= 0) close(right_fd);
+}
+
+bool TcpCommunicator::connectRing(const std::vector<std::string>& addresses) {
+    auto start = std::chrono::steady_clock::now();
+    const std::string& own = addresses[rank_id];
+    const std::string& next = addresses[(rank_id + 1) % world_size];
+
+    // listen first, so the left neighbour's connect is queued until we accept it below
+    addrinfo* local = resolve(own, true);
+    if (!local) return false;
+    int listen_fd = socket(local->ai_family, local->ai_socktype, local->ai_protocol);
+    int one = 1;
+    if (listen_fd >= 0) setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (listen_fd < 0 || bind(listen_fd, local->ai_addr, local->ai_addrlen) != 0 || listen(listen_fd, 4) != 0) {
+        std::cerr << "Cannot listen on " << own << ": " << std::strerror(errno) << std::endl;
+        freeaddrinfo(local);
+        if (listen_fd >= 0) close(listen_fd);
+        return false;
+    }
+    freeaddrinfo(local);
+
+    // the right neighbour may not be listening yet
+    uint32_t hello[2] = {static_cast<uint32_t>(rank_id), static_cast<uint32_t>(world_size)};
+    while (right_fd < 0) {
+        if (addrinfo* remote = resolve(next, false)) {
+            for (addrinfo* a=remote; a && right_fd < 0; a=a->ai_next) {
+                right_fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+                if (right_fd >= 0 && connect(right_fd, a->ai_addr, a->ai_addrlen) != 0) {
+                    close(right_fd);
+                    right_fd = -1;
+                }
+            }
+            freeaddrinfo(remote);
+        }
+        if (right_fd >= 0 && !writeAll(right_fd, hello, sizeof(hello))) {
+            close(right_fd);
+            right_fd = -1;
+        }
+        if (right_fd >= 0) break;
+        if (secondsSince(start) > timeout_seconds) {
+            std::cerr << "Timed out connecting to rank " << (rank_id + 1) % world_size << " at " << next << std::endl;
+            close(listen_fd);
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // accept the left neighbour, anything else that connects is turned away
+    size_t left = (rank_id + world_size - 1) % world_size;
+    while (left_fd < 0) {
+        pollfd listening{listen_fd, POLLIN, 0};
+        int remaining_ms = static_cast<int>(std::max(0.0, timeout_seconds - secondsSince(start)) * 1000);
+        if (poll(&listening, 1, remaining_ms) <= 0) {
+            std::cerr << "Timed out waiting for rank " << left << " to connect to " << own << std::endl;
+            close(listen_fd);
+            return false;
+        }
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) continue;
+        uint32_t peer[2];
+        if (readAll(fd, peer, sizeof(peer)) && peer[0] == left && peer[1] == world_size) {
+            left_fd = fd;
+        }
+        else {
+            std::cerr << "Warning: rejected a connection on " << own << " that isn't rank " << left << std::endl;
+            close(fd);
+        }
+    }
+    close(listen_fd);
+    configure(left_fd);
+    configure(right_fd);
+    return true;
+}
+
+bool TcpCommunicator::isConnected() const {
+    return rank_id < world_size && (world_size == 1 || (left_fd >= 0 && right_fd >= 0));
+}
+
+void TcpCommunicator::setCompression(GradientCompression _compression, double _top_k_fraction) {
+    compression = _compression;
+    top_k_fraction = std::min(std::max(_top_k_fraction, 0.0), 1.0);
+    residuals.clear();
+}
+
+size_t TcpCommunicator::rank() const {
+    return rank_id;
+}
+
+size_t TcpCommunicator::size() const {
+    return world_size;
+}
+
+bool TcpCommunicator::exchange(const void* out, size_t out_bytes, void* in, size_t in_bytes) {
+    auto* out_ptr = static_cast<const char*>(out);
+    auto* in_ptr = static_cast<char*>(in);
+    auto start = std::chrono::steady_clock::now();
+    while (out_bytes > 0 || in_bytes > 0) {
+        pollfd fds[2] = {{right_fd, static_cast<short>(out_bytes > 0 ? POLLOUT : 0), 0},
+                         {left_fd, static_cast<short>(in_bytes > 0 ? POLLIN : 0), 0}};
+        int ready = poll(fds, 2, 100);
+        if (ready < 0 && errno != EINTR) break;
+        if (ready <= 0) {
+            if (secondsSince(start) > timeout_seconds) {
+                std::cerr << "Error: all-reduce timed out, a rank stopped responding" << std::endl;
+                return false;
+            }
+            continue;
+        }
+        if (out_bytes > 0 && (fds[0].revents & (POLLERR | POLLHUP))) break;
+        if (out_bytes > 0 && (fds[0].revents & POLLOUT)) {
+            ssize_t n = send(right_fd, out_ptr, out_bytes, send_flags);
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) break;
+            if (n > 0) {
+                out_ptr += n;
+                out_bytes -= n;
+            }
+        }
+        if (in_bytes > 0 && (fds[1].revents & (POLLIN | POLLHUP | POLLERR))) {
+            ssize_t n = recv(left_fd, in_ptr, in_bytes, 0);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) break;
+            if (n > 0) {
+                in_ptr += n;
+                in_bytes -= n;
+            }
+        }
+        start = std::chrono::steady_clock::now(); // the timeout is for a stall, not for a long message
+    }
+    if (out_bytes == 0 && in_bytes == 0) return true;
+    std::cerr << "Error: all-reduce lost its connection to a neighbouring rank" << std::endl;
+    return false;
+}
+
+bool TcpCommunicator::ringAllReduce(double* values, size_t count, bool half) {
+    size_t N = world_size;
+    auto chunkBegin = [count, N](size_t c) { return c * count / N; };
+    auto chunk = [this, N](size_t step_back) { return (rank_id + N - step_back % N) % N; };
+    auto encode = [&](size_t c) {
+        half_out.resize(chunkBegin(c + 1) - chunkBegin(c));
+        for (size_t k=0; k<half_out.size(); ++k) half_out[k] = toGradientHalf(values[chunkBegin(c) + k]);
+    };
+    // reduce-scatter: pass on the partial chunk just received (own values added), after N-1 steps
+    // chunk rank+1 holds every rank's values
+    for (size_t s=0; s+1<N; ++s) {
+        size_t out = chunk(s), in = chunk(s + 1);
+        size_t in_n = chunkBegin(in + 1) - chunkBegin(in);
+        double* target = values + chunkBegin(in);
+        if (half) {
+            encode(out);
+            half_in.resize(in_n);
+            if (!exchange(half_out.data(), half_out.size() * sizeof(uint16_t), half_in.data(), in_n * sizeof(uint16_t))) return false;
+            for (size_t k=0; k<in_n; ++k) target[k] += fromFloat16(half_in[k]);
+        }
+        else {
+            chunk_buffer.resize(in_n);
+            if (!exchange(values + chunkBegin(out), (chunkBegin(out + 1) - chunkBegin(out)) * sizeof(double),
+                          chunk_buffer.data(), in_n * sizeof(double))) return false;
+            for (size_t k=0; k<in_n; ++k) target[k] += chunk_buffer[k];
+        }
+    }
+    if (half) { // the others only get the float16 of the finished chunk, so its owner must use that too
+        size_t own = (rank_id + 1) % N;
+        for (size_t k=chunkBegin(own); k<chunkBegin(own + 1); ++k) values[k] = fromFloat16(toGradientHalf(values[k]));
+    }
+    // all-gather: the finished chunks go once around the ring
+    for (size_t s=0; s+1<N; ++s) {
+        size_t out = (rank_id + 1 + N - s) % N, in = chunk(s);
+        size_t in_n = chunkBegin(in + 1) - chunkBegin(in);
+        if (half) {
+            encode(out);
+            half_in.resize(in_n);
+            if (!exchange(half_out.data(), half_out.size() * sizeof(uint16_t), half_in.data(), in_n * sizeof(uint16_t))) return false;
+            for (size_t k=0; k<in_n; ++k) values[chunkBegin(in) + k] = fromFloat16(half_in[k]);
+        }
+        else if (!exchange(values + chunkBegin(out), (chunkBegin(out + 1) - chunkBegin(out)) * sizeof(double),
+                           values + chunkBegin(in), in_n * sizeof(double))) return false;
+    }
+    return true;
+}
+
+bool TcpCommunicator::allReduce(double* values, size_t count) {
+    if (!isConnected()) return false;
+    if (world_size == 1) return true;
+    return ringAllReduce(values, count, false);
+}
+
+bool TcpCommunicator::allReduceGradients(double* values, size_t count, size_t stream) {
+    if (!isConnected()) return false;
+    if (world_size == 1) return true;
+    if (compression == NoCompression || count > UINT32_MAX) return ringAllReduce(values, count, false);
+
+    std::vector<double>& residual = residuals[stream];
+    if (residual.size() != count) residual.assign(count, 0.0); // new stream, or its buffer changed shape
+    for (size_t i=0; i<count; ++i) values[i] += residual[i];
+    if (compression == HalfGradients) {
+        for (size_t i=0; i<count; ++i) {
+            double sent = fromFloat16(toGradientHalf(values[i]));
+            residual[i] = values[i] - sent;
+            values[i] = sent;
+        }
+        return ringAllReduce(values, count, true);
+    }
+    return topKAllReduce(values, count, residual);
+}
+
+bool TcpCommunicator::topKAllReduce(double* values, size_t count, std::vector<double>& residual) {
+    size_t k = std::min(count, std::max<size_t>(1, static_cast<size_t>(std::ceil(top_k_fraction * count))));
+    order.resize(count);
+    for (size_t i=0; i<count; ++i) order[i] = static_cast<uint32_t>(i);
+    std::nth_element(order.begin(), order.begin() + k, order.end(), [values](uint32_t a, uint32_t b) {
+        return std::fabs(values[a]) > std::fabs(values[b]);
+    });
+    std::sort(order.begin(), order.begin() + k); // sums walk the gradients in order
+
+    // message: k indices, then k float values
+    std::vector<char>& own = gathered[rank_id];
+    own.resize(k * (sizeof(uint32_t) + sizeof(float)));
+    std::memcpy(own.data(), order.data(), k * sizeof(uint32_t));
+    auto* own_values = reinterpret_cast<float*>(own.data() + k * sizeof(uint32_t));
+    std::copy(values, values + count, residual.begin()); // all that isn't sent is fed back
+    for (size_t j=0; j<k; ++j) {
+        own_values[j] = static_cast<float>(values[order[j]]);
+        residual[order[j]] = values[order[j]] - own_values[j];
+    }
+
+    // all-gather: every message goes once around the ring
+    size_t N = world_size;
+    for (size_t s=0; s+1<N; ++s) {
+        size_t out = (rank_id + N - s) % N, in = (rank_id + N - s - 1) % N;
+        uint64_t out_bytes = gathered[out].size(), in_bytes = 0;
+        if (!exchange(&out_bytes, sizeof(out_bytes), &in_bytes, sizeof(in_bytes))) return false;
+        if (in_bytes % (sizeof(uint32_t) + sizeof(float)) != 0 || in_bytes > count * (sizeof(uint32_t) + sizeof(float))) {
+            std::cerr << "Error: malformed top-k message from rank " << in << std::endl;
+            return false;
+        }
+        gathered[in].resize(in_bytes);
+        if (!exchange(gathered[out].data(), out_bytes, gathered[in].data(), in_bytes)) return false;
+    }
+
+    // summed in rank order, so every rank rounds the same way
+    std::fill(values, values + count, 0.0);
+    for (const auto& message : gathered) {
+        size_t n = message.size() / (sizeof(uint32_t) + sizeof(float));
+        const char* indices = message.data();
+        const char* floats = message.data() + n * sizeof(uint32_t);
+        for (size_t j=0; j<n; ++j) {
+            uint32_t index;
+            float value;
+            std::memcpy(&index, indices + j * sizeof(uint32_t), sizeof(index));
+            std::memcpy(&value, floats + j * sizeof(float), sizeof(value));
+            if (index < count) values[index] += value;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,66 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef TCPCOMMUNICATOR_H
+#define TCPCOMMUNICATOR_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "Communicator.h"
+
+enum GradientCompression { // what allReduceGradients sends, allReduce is always exact
+    NoCompression,
+    HalfGradients, // float16 values, a quarter of the traffic
+    TopKGradients, // only the largest |values| as (index, float) pairs
+};
+
+// Communicator between processes on any machines over TCP, for training past a single box. The ranks form a ring:
+// each connects to the next rank's address and accepts the previous one, and allReduce is the same ring
+// all-reduce as SharedMemoryCommunicator (reduce-scatter, then all-gather), sending and receiving at once so the
+// ring never waits on a full socket buffer. Values go in the machine's byte order, so keep the ranks on one
+// architecture.
+//
+// Compression only applies to allReduceGradients. Whatever a rank's compressed message leaves out of its
+// gradients (the float16 rounding, or everything below the top k) is kept per stream and added to the next step's
+// gradients (error feedback), so small gradients are delayed rather than lost. Compressed sums are rounded the
+// same way on every rank, so the replicas still agree exactly. Top-k all-gathers every rank's pairs and sums
+// them in rank order; it pays off while k is well below count / ranks.
+class TcpCommunicator : public Communicator {
+    size_t rank_id, world_size;
+    double timeout_seconds;
+    int left_fd = -1, right_fd = -1; // receive from rank - 1, send to rank + 1
+    GradientCompression compression = NoCompression;
+    double top_k_fraction = 0.01;
+    std::map<size_t, std::vector<double>> residuals; // error feedback per gradient stream
+    std::vector<double> chunk_buffer;
+    std::vector<uint16_t> half_out, half_in;
+    std::vector<uint32_t> order;
+    std::vector<std::vector<char>> gathered; // top-k messages by origin rank
+
+    bool connectRing(const std::vector<std::string>& addresses);
+    // sends out to the right neighbour while receiving in from the left one
+    bool exchange(const void* out, size_t out_bytes, void* in, size_t in_bytes);
+    bool ringAllReduce(double* values, size_t count, bool half); // half: float16 on the wire
+    bool topKAllReduce(double* values, size_t count, std::vector<double>& residual);
+
+public:
+    // addresses[r] is rank r's "host:port", where it listens. blocks until both neighbours are connected (or the
+    // timeout passed, then isConnected is false); the timeout also bounds every later exchange
+    TcpCommunicator(const std::vector<std::string>& addresses, size_t rank, double timeout_seconds = 60);
+    ~TcpCommunicator() override;
+    TcpCommunicator(const TcpCommunicator&) = delete;
+    TcpCommunicator& operator=(const TcpCommunicator&) = delete;
+
+    bool isConnected() const;
+    // every rank has to use the same setting. top_k_fraction is the share of values each rank sends with TopKGradients
+    void setCompression(GradientCompression, double top_k_fraction = 0.01);
+    size_t rank() const override;
+    size_t size() const override;
+    bool allReduce(double* values, size_t count) override;
+    bool allReduceGradients(double* values, size_t count, size_t stream) override;
+};
+
+#endif //TCPCOMMUNICATOR_H
@@ -0,0 +1,279 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+    thread_local const ThreadPool* current_pool = nullptr;
+    thread_local size_t current_worker = 0;
+
+    std::mutex global_mtx;
+    ThreadPoolOptions global_options;
+    bool global_created = false;
+
+    // "0-3,8-11" -> 0 1 2 3 8 9 10 11
+    std::vector<int> parseCpuList(const std::string& list) {
+        std::vector<int> cpus;
+        std::stringstream ranges(list);
+        std::string range;
+        while (std::getline(ranges, range, ',')) {
+            size_t dash = range.find('-');
+            int first = std::atoi(range.c_str());
+            int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+            for (int cpu=first; cpu<=last; ++cpu) cpus.push_back(cpu);
+        }
+        return cpus;
+    }
+
+    // the cpus of each NUMA node from sysfs, or a single node with every hardware thread where that isn't available
+    std::vector<std::vector<int>> numaNodeCpus() {
+        std::vector<std::vector<int>> nodes;
+        for (int node=0; node<256; ++node) {
+            std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            std::string list;
+            if (file && std::getline(file, list)) {
+                std::vector<int> cpus = parseCpuList(list);
+                if (!cpus.empty()) nodes.push_back(cpus);
+            }
+        }
+        if (nodes.empty()) {
+            nodes.emplace_back();
+            for (unsigned int cpu=0; cpu<std::max(1u, std::thread::hardware_concurrency()); ++cpu) {
+                nodes.back().push_back(static_cast<int>(cpu));
+            }
+        }
+        return nodes;
+    }
+
+    ThreadPoolOptions globalOptions() {
+        std::lock_guard<std::mutex> lock(global_mtx);
+        ThreadPoolOptions options = global_options;
+        if (const char* threads = std::getenv("NN_THREADS")) {
+            long count = std::atol(threads);
+            if (count > 0) options.threads = static_cast<size_t>(count);
+        }
+        if (const char* pin = std::getenv("NN_PIN_THREADS")) options.pin_threads = std::atoi(pin) != 0;
+        global_created = true;
+        return options;
+    }
+}
+
+TaskGroup::TaskGroup(ThreadPool& _pool) : pool(_pool) {}
+
+TaskGroup::TaskGroup() : pool(ThreadPool::global()) {}
+
+TaskGroup::~TaskGroup() {
+    wait();
+}
+
+void TaskGroup::run(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        ++pending;
+    }
+    pool.submit([this, task] {
+        task();
+        // decrement and notify under the lock: wait() can only see 0, return and destroy the group after this
+        std::lock_guard<std::mutex> lock(mtx);
+        if (--pending == 0) done_cv.notify_all();
+    });
+}
+
+void TaskGroup::wait() {
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (pending == 0) return;
+        }
+        if (pool.runPendingTask()) continue; // help instead of blocking, ours may be among the queued tasks
+        std::unique_lock<std::mutex> lock(mtx);
+        // the remaining tasks are running elsewhere. wake up now and then in case new work is queued meanwhile
+        done_cv.wait_for(lock, std::chrono::microseconds(200), [this] { return pending == 0; });
+    }
+}
+
+ThreadPool::ThreadPool(const ThreadPoolOptions& options) {
+    size_t count = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i=1; i<count; ++i) {
+        workers.emplace_back(new Worker());
+    }
+    placeWorkers(options);
+    for (size_t i=0; i<workers.size(); ++i) {
+        workers[i]->thread = std::thread(&ThreadPool::workerLoop, this, i);
+#ifdef __linux__
+        if (workers[i]->cpu >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(workers[i]->cpu, &set);
+            pthread_setaffinity_np(workers[i]->thread.native_handle(), sizeof(set), &set);
+        }
+#endif
+    }
+}
+
+void ThreadPool::placeWorkers(const ThreadPoolOptions& options) {
+    if (options.pin_threads) {
+        // cpu slots in placement order, the first one is left to the thread that calls into the pool
+        std::vector<std::vector<int>> nodes = numaNodeCpus();
+        std::vector<std::pair<int, int>> slots; // cpu, node
+        if (options.spread_numa_nodes) {
+            size_t widest = 0;
+            for (const auto& cpus : nodes) widest = std::max(widest, cpus.size());
+            for (size_t k=0; k<widest; ++k) {
+                for (size_t node=0; node<nodes.size(); ++node) {
+                    if (k < nodes[node].size()) slots.emplace_back(nodes[node][k], static_cast<int>(node));
+                }
+            }
+        }
+        else {
+            for (size_t node=0; node<nodes.size(); ++node) {
+                for (int cpu : nodes[node]) slots.emplace_back(cpu, static_cast<int>(node));
+            }
+        }
+        for (size_t i=0; i<workers.size(); ++i) {
+            workers[i]->cpu = slots[(i + 1) % slots.size()].first;
+            workers[i]->numa_node = slots[(i + 1) % slots.size()].second;
+        }
+    }
+    // unpinned workers can run anywhere, they all count as node 0
+    for (size_t i=0; i<workers.size(); ++i) {
+        auto& victims = workers[i]->victims;
+        for (size_t k=1; k<workers.size(); ++k) victims.push_back((i + k) % workers.size());
+        std::stable_partition(victims.begin(), victims.end(), [this, i](size_t v) {
+            return workers[v]->numa_node == workers[i]->numa_node;
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mtx);
+        stopping = true;
+    }
+    sleep_cv.notify_all();
+    for (auto& worker : workers) {
+        worker->thread.join();
+    }
+    std::function<void()> task;
+    while (takeTask(task)) task(); // nothing is lost when there are no workers
+}
+
+size_t ThreadPool::size() const {
+    return workers.size() + 1;
+}
+
+ThreadPool& ThreadPool::global() {
+    static ThreadPool pool(globalOptions());
+    return pool;
+}
+
+bool ThreadPool::setGlobalOptions(const ThreadPoolOptions& options) {
+    std::lock_guard<std::mutex> lock(global_mtx);
+    if (global_created) return false;
+    global_options = options;
+    return true;
+}
+
+bool ThreadPool::takeTask(std::function<void()>& task) {
+    bool is_worker = current_pool == this;
+    if (is_worker) { // own deque, newest first
+        Worker& self = *workers[current_worker];
+        std::lock_guard<std::mutex> lock(self.mtx);
+        if (!self.tasks.empty()) {
+            task = std::move(self.tasks.back());
+            self.tasks.pop_back();
+            --queued;
+            return true;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(injected_mtx);
+        if (!injected.empty()) {
+            task = std::move(injected.front());
+            injected.pop_front();
+            --queued;
+            return true;
+        }
+    }
+    // steal the oldest task of another worker, same NUMA node first
+    size_t victim_count = is_worker ? workers[current_worker]->victims.size() : workers.size();
+    for (size_t k=0; k<victim_count; ++k) {
+        Worker& victim = *workers[is_worker ? workers[current_worker]->victims[k] : k];
+        std::lock_guard<std::mutex> lock(victim.mtx);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            --queued;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    current_pool = this;
+    current_worker = index;
+    std::function<void()> task;
+    while (true) {
+        if (takeTask(task)) {
+            task();
+            task = nullptr; // release the captures before sleeping
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mtx);
+        sleep_cv.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0) return;
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    if (current_pool == this) {
+        Worker& self = *workers[current_worker];
+        std::lock_guard<std::mutex> lock(self.mtx);
+        self.tasks.push_back(std::move(task));
+    }
+    else {
+        std::lock_guard<std::mutex> lock(injected_mtx);
+        injected.push_back(std::move(task));
+    }
+    ++queued;
+    {
+        std::lock_guard<std::mutex> lock(sleep_mtx); // a worker between its check and its wait can't miss this
+    }
+    sleep_cv.notify_one();
+}
+
+bool ThreadPool::runPendingTask() {
+    std::function<void()> task;
+    if (!takeTask(task)) return false;
+    task();
+    return true;
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) return;
+    if (count == 1 || workers.empty()) {
+        for (size_t i=0; i<count; ++i) body(i);
+        return;
+    }
+    std::atomic<size_t> next_index{0};
+    auto claim = [&next_index, &body, count] {
+        for (size_t i = next_index++; i < count; i = next_index++) body(i);
+    };
+    TaskGroup group(*this);
+    size_t helpers = std::min(workers.size(), count - 1);
+    for (size_t h=0; h<helpers; ++h) group.run(claim);
+    claim();
+    group.wait(); // helpers that start late find nothing left, but still read next_index
+}
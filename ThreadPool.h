@@ -0,0 +1,90 @@
+//
+// Created by Gun woo Kim on 10/19/26.
+//
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ThreadPoolOptions {
+    size_t threads = 0; // counting the thread that waits on the work, 0 = one per hardware thread
+    bool pin_threads = false; // pin each worker to one core (Linux, ignored elsewhere)
+    bool spread_numa_nodes = true; // when pinning: deal the workers out over the NUMA nodes in turn, else fill node by node
+};
+
+class ThreadPool;
+
+// Fork-join over the pool: run() queues tasks, wait() returns once all of them are done. The waiting thread
+// executes queued tasks itself meanwhile, so groups can nest (a task may wait on its own group) without
+// tying up a worker. The destructor waits.
+class TaskGroup {
+    ThreadPool& pool;
+    std::atomic<size_t> pending{0};
+    std::mutex mtx;
+    std::condition_variable done_cv;
+
+public:
+    explicit TaskGroup(ThreadPool&);
+    TaskGroup(); // on ThreadPool::global()
+    ~TaskGroup();
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(std::function<void()> task);
+    void wait();
+};
+
+// The process-wide work-stealing scheduler used by every parallel path of the library (tensor-parallel layers,
+// batched kernels, cost evaluation), so they share one set of threads instead of each
+// oversubscribing the cores with its own. Each worker has a deque: it pushes and pops its own tasks at the back
+// (the most recent, cache-warm ones) and, when it runs out, steals the oldest from the front of another's,
+// trying workers on its own NUMA node first. Tasks from threads outside the pool go to a shared queue.
+class ThreadPool {
+    struct Worker {
+        std::deque<std::function<void()>> tasks;
+        std::mutex mtx;
+        int cpu = -1; // pinned to, -1 = not pinned
+        int numa_node = 0;
+        std::vector<size_t> victims; // steal order, same node first
+        std::thread thread;
+    };
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::deque<std::function<void()>> injected; // submitted from outside the pool
+    std::mutex injected_mtx;
+    std::atomic<size_t> queued{0};
+    std::mutex sleep_mtx;
+    std::condition_variable sleep_cv;
+    bool stopping = false;
+
+    void workerLoop(size_t index);
+    bool takeTask(std::function<void()>& task);
+    void placeWorkers(const ThreadPoolOptions&); // cpu, node and steal order of each worker
+
+public:
+    explicit ThreadPool(const ThreadPoolOptions& = ThreadPoolOptions());
+    ~ThreadPool(); // runs the tasks still queued, then joins
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const; // threads working on a parallelFor, the caller included
+    void submit(std::function<void()> task); // fire and forget; use a TaskGroup to wait for it
+    bool runPendingTask(); // runs one queued task on the calling thread, false if there was none
+    // body(i) for every i < count, returns when all are done. indices are claimed dynamically by the caller and
+    // up to size() - 1 helpers, so uneven indices balance out; nested calls are fine
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    // the shared pool, created on first use. NN_THREADS and NN_PIN_THREADS=1 override the options
+    static ThreadPool& global();
+    // false (and nothing changes) once the shared pool exists
+    static bool setGlobalOptions(const ThreadPoolOptions&);
+};
+
+#endif //THREADPOOL_H
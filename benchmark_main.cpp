@@ -0,0 +1,76 @@
+#include <iostream>
+#include <string>
+#include "Benchmark.h"
+
+using namespace std;
+
+// usage: neuralnetwork_benchmark [--record | --check | --roofline | --check-allocations | --memory-plan] [--tolerance 0.1] [--machine-class name] [--baseline-dir dir] [--checkpoint-every k]
+//   (no mode)  run the benchmarks and print the throughput
+//   --record   overwrite <baseline-dir>/<machine-class>.json with this run
+//   --check    compare against the stored baseline, exit 1 if forward/backward/fit throughput regressed past tolerance
+//   --roofline print per layer FLOP/byte counts, achieved GFLOP/s and GB/s against the measured machine peak
+//   --check-allocations  exit 1 if a training step allocates after warm-up (build with -DNN_TRACK_ALLOCATIONS=ON)
+//   --memory-plan  print the arena layout and peak memory of a batched training step (with checkpoints every k layers)
+int main(int argc, char* argv[]) {
+    string mode;
+    string machine_class = Benchmark::defaultMachineClass();
+    string baseline_dir = "../baselines"; // same layout as arial.ttf, run from the build directory
+    double tolerance = 0.10;
+    size_t checkpoint_every = 0;
+
+    for (int i=1; i<argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--record" || arg == "--check" || arg == "--roofline" || arg == "--check-allocations" || arg == "--memory-plan") {
+            mode = arg;
+        }
+        else if (arg == "--tolerance" && i+1 < argc) {
+            tolerance = stod(argv[++i]);
+        }
+        else if (arg == "--machine-class" && i+1 < argc) {
+            machine_class = argv[++i];
+        }
+        else if (arg == "--baseline-dir" && i+1 < argc) {
+            baseline_dir = argv[++i];
+        }
+        else if (arg == "--checkpoint-every" && i+1 < argc) {
+            checkpoint_every = stoul(argv[++i]);
+        }
+        else {
+            cerr << "Unknown argument: " << arg << endl;
+            return 2;
+        }
+    }
+    string baseline_path = baseline_dir + "/" + machine_class + ".json";
+
+    Benchmark benchmark;
+    benchmark.addDefaultCases();
+    if (mode == "--roofline") {
+        benchmark.printRooflineReports();
+        return 0;
+    }
+    if (mode == "--check-allocations") {
+        return benchmark.verifyAllocationFreeSteps() ? 0 : 1;
+    }
+    if (mode == "--memory-plan") {
+        benchmark.printMemoryPlans(64, checkpoint_every);
+        return 0;
+    }
+    auto results = benchmark.run();
+
+    if (mode == "--record") {
+        if (!Benchmark::saveBaseline(baseline_path, machine_class, results)) return 2;
+        cout << "Baseline written to " << baseline_path << endl;
+        return 0;
+    }
+
+    map<string, double> baseline;
+    if (mode == "--check" && !Benchmark::loadBaseline(baseline_path, baseline)) return 2;
+
+    cout << "Machine class: " << machine_class << endl;
+    int regressions = Benchmark::compare(baseline, results, tolerance);
+    if (regressions > 0) {
+        cout << regressions << " metric(s) regressed more than " << tolerance * 100 << "% or went missing against " << baseline_path << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -2,6 +2,7 @@
 // Created by Gun woo Kim on 8/22/24.
 //
 #include "NeuralNetwork.h"
+#include "FastMath.h"
 #include <vector>
 
 using namespace std;
@@ -19,14 +20,19 @@ double relu(double x) {
 }
 
 std::vector<double> softmax(const std::vector<double>& logits) {
-    std::vector<double> exp_values(logits.size());
+    std::vector<double> exp_values;
+    softmax(logits, exp_values);
+    return exp_values;
+}
+
+void softmax(const std::vector<double>& logits, std::vector<double>& exp_values) {
+    exp_values.resize(logits.size());
     double max_logit = *std::max_element(logits.begin(), logits.end());
     for (size_t i = 0; i < logits.size(); ++i)
         exp_values[i] = std::exp(logits[i] - max_logit);
     double sum_exp_values = std::accumulate(exp_values.begin(), exp_values.end(), 0.0);
     for (double &val : exp_values)
         val /= sum_exp_values;
-    return exp_values;
 }
 
 double loss_MSE(const double& y_hat, const double& y) {
@@ -55,6 +61,40 @@ double loss_CategoricalCrossEntropy(const std::vector<double> &y_hat, const std:
     return -categorical_ce;
 }
 
+double loss_compute(LossFxn loss_fxn, const std::vector<double>& y_hat, const std::vector<double>& y) {
+    return loss_compute(loss_fxn, y_hat, y.data());
+}
+
+double loss_compute(LossFxn loss_fxn, const std::vector<double>& y_hat, const double* y) {
+    return loss_compute(loss_fxn, y_hat.data(), y, y_hat.size());
+}
+
+double loss_compute(LossFxn loss_fxn, const double* y_hat, const double* y, size_t n) {
+    switch (loss_fxn) {
+        case MSE: { // same as loss_MSE / multi_output_MSE, on a raw label row
+            double squaredError = 0;
+            for (size_t i = 0; i < n; ++i)
+                squaredError += loss_MSE(y_hat[i], y[i]);
+            return squaredError / n;
+        }
+        case BinaryCrossEntropy:
+            if (n == 1)
+                return loss_BinaryCrossEntropy(y_hat[0], y[0]);
+            break;
+        case CategoricalCrossEntropy:
+            if (n > 1) {
+                double categorical_ce = 0;
+                for (size_t i = 0; i < n; ++i)
+                    categorical_ce += y[i] * std::log(std::max(y_hat[i], 1e-15));  // preventing log(0)
+                return -categorical_ce;
+            }
+            break;
+        default:
+            break;
+    }
+    return 0;
+}
+
 int randomNumber(const int& min_val, const int& max_val) {
     static bool seeded = false;
     if (!seeded) {
@@ -78,6 +118,33 @@ double lossFunctionDerivative(LossFxn loss_fxn, const double &y_hat, const doubl
     }
 }
 
+double activationDerivativeFromOutput(ActivationType activationType, double a) {
+    switch (activationType) {
+        case LINEAR:
+            return 1;
+        case SIGMOID:
+            return a * (1 - a);
+        case RELU:
+            return a > 0 ? 1 : 0;
+        case TANH:
+            return 1 - a * a;
+        case SOFTMAX:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+double tableSigmoid(double x) {
+    static const ActivationTable table(&sigmoid, 16.0); // sigmoid(16) is within 1.2e-7 of 1
+    return table(x);
+}
+
+double tableTanh(double x) {
+    static const ActivationTable table([](double v) { return std::tanh(v); }, 8.0); // tanh(8) is within 2.3e-7 of 1
+    return table(x);
+}
+
 double activationFxnDerivative(ActivationType activationType, const double& z) {
     switch (activationType) {
         case LINEAR:
@@ -5,6 +5,8 @@
 #ifndef UTILITY_H
 #define UTILITY_H
 
+#include <cstddef>
+
 enum LossFxn {
     MSE,
     BinaryCrossEntropy,
@@ -25,18 +27,43 @@ enum GradientDescentType {
     Batch,
 };
 
+enum TrainingPhase {
+    ForwardPass,
+    BackwardPass, // deltas and weight/bias gradients
+    WeightUpdate,
+};
+
+enum ActivationAccuracy { // how SIGMOID and TANH are evaluated, the other activations are exact in every mode
+    Exact, // libm
+    Polynomial, // range reduced exp polynomial, ~1e-8 relative error
+    LookupTable, // interpolated table, ~1e-6 absolute error
+};
+
+enum WeightPrecision { // how a layer's forward pass reads its weights, the double weights stay the master copy
+    FullPrecision,
+    BFloat16,
+    Float16,
+};
+
 double linear(double x);
 double sigmoid(double x);
 double relu(double x);
 std::vector<double> softmax(const std::vector<double>& logits);
+void softmax(const std::vector<double>& logits, std::vector<double>& out); // writes into out, no allocation once sized
 double loss_MSE(const double& y_hat, const double& y);
 double multi_output_MSE(const std::vector<double>& y_hats, const std::vector<double>& ys);
 double loss_BinaryCrossEntropy(double y_hat, double y);
 double loss_CategoricalCrossEntropy(const std::vector<double>& y_hat, const std::vector<double>& y);
+double loss_compute(LossFxn loss_fxn, const std::vector<double>& y_hat, const std::vector<double>& y); // loss of one sample
+double loss_compute(LossFxn loss_fxn, const std::vector<double>& y_hat, const double* y); // y has y_hat.size() values
+double loss_compute(LossFxn loss_fxn, const double* y_hat, const double* y, size_t n);
 int randomNumber(const int& min_val, const int& max_val);
 
 double lossFunctionDerivative(LossFxn loss_fxn, const double &y_hat, const double &y);
-double activationFxnDerivative(ActivationType, const double &a);
+double activationFxnDerivative(ActivationType, const double &z);
+double activationDerivativeFromOutput(ActivationType, double a); // same derivative from the cached output a = f(z)
+double tableSigmoid(double x); // LookupTable mode, see FastMath.h
+double tableTanh(double x);
 
 
 #endif //UTILITY_H